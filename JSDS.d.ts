@@ -52,6 +52,12 @@ interface Console {
 	get textColor(): number;
 	set textBackground(color: number | string);
 	get textBackground(): number;
+	/**
+	 * Path of a file that console output is also written to, or null if not logging.
+	 * Output is appended to the file in the background. Colors are kept as ANSI escape codes.
+	 * Set to null to stop logging. Throws if the file can't be opened, in which case the current log file is kept.
+	 */
+	logFile: string | null;
 }
 declare var console: Console;
 
@@ -135,6 +141,8 @@ interface FileBrowseOptions {
  * This is nothing like the File class you may know from the web.
  */
 interface File {
+	/** The mode the file was opened with. */
+	readonly mode: FileMode;
 	/**
 	 * Reads a certain amount of bytes from the file.
 	 * @returns A `Uint8Array` with its size is determined by the number of bytes read,
@@ -667,6 +675,200 @@ declare var Video: {
 	};
 };
 
+type BackgroundType = "text4bpp" | "text8bpp" | "affine" | "extended" | "bitmap8" | "bitmap16";
+/**
+ * A background layer. Tiled backgrounds are made of a tileset and a map of which tile goes where,
+ * while bitmap backgrounds show a `Bitmap`.
+ * Scroll and affine changes are applied at the next vblank.
+ */
+interface Background {
+	/** The layer (0-3) on its engine. */
+	readonly layer: number;
+	readonly type: BackgroundType;
+	/** Width of the map in pixels. */
+	readonly width: number;
+	/** Height of the map in pixels. */
+	readonly height: number;
+	readonly main: boolean;
+	/** The bitmap shown by a bitmap background, or `null` for tiled backgrounds. */
+	readonly bitmap: Bitmap | null;
+	/** Whether this is a bitmap background with two pages, see `BackgroundEngine.init()`. */
+	readonly doubleBuffered: boolean;
+	/** Horizontal scroll in pixels. */
+	x: number;
+	/** Vertical scroll in pixels. */
+	y: number;
+	/** Drawing priority (0-3), with lower values in front. */
+	priority: number;
+	hidden: boolean;
+	setScroll(x: number, y: number): void;
+	/**
+	 * Sets the rotation and scale of an affine, extended, or bitmap background, around its center.
+	 * @param angle Rotation angle in degrees.
+	 * @param sx Inverse X scale.
+	 * @param sy Inverse Y scale.
+	 * @throws If this is a text background.
+	 */
+	rotateScale(angle: number, sx: number, sy: number): void;
+	/**
+	 * Sets the point that rotation and scaling happen around.
+	 * @throws If this is a text background.
+	 */
+	setCenter(x: number, y: number): void;
+	/**
+	 * Gets the map entry at a tile position. Positions wrap around the map.
+	 * Methods dealing with tiles throw on bitmap backgrounds.
+	 * 
+	 * Entries of text and extended backgrounds hold the tile number in bits 0-9, horizontal and vertical flips in bits 10 and 11,
+	 * and the palette in bits 12-15 for 4bpp tiles. Entries of affine backgrounds are only a tile number (0-255).
+	 */
+	getTile(x: number, y: number): number;
+	/** Sets the map entry at a tile position. Positions wrap around the map. */
+	setTile(x: number, y: number, entry: number): void;
+	/**
+	 * Sets an area of map entries from a row-major array, wrapping around the map.
+	 * @throws If the area is larger than the map, or `entries` holds less than `width * height` entries.
+	 */
+	setTiles(x: number, y: number, width: number, height: number, entries: Uint8Array | Uint16Array): void;
+	/**
+	 * Copies tile graphics into the tileset by DMA.
+	 * @param offset Byte offset into the tileset. Defaults to `0`.
+	 * @param compressed Whether `data` is LZ77, Huffman, or RLE compressed, in the format used by the DS BIOS. Defaults to `false`.
+	 * @throws If the data doesn't fit in the tileset after `offset`.
+	 */
+	uploadTiles(data: TypedArray, offset?: number, compressed?: boolean): void;
+	/**
+	 * Copies map entries into the map by DMA. Text backgrounds over 256 pixels wide or tall store their map as 32x32 tile blocks.
+	 * @param offset Byte offset into the map. Defaults to `0`.
+	 * @param compressed Whether `data` is LZ77, Huffman, or RLE compressed, in the format used by the DS BIOS. Defaults to `false`.
+	 * @throws If the data doesn't fit in the map after `offset`.
+	 */
+	uploadMap(data: TypedArray, offset?: number, compressed?: boolean): void;
+}
+interface BackgroundEngine {
+	/** The background palette, as 256 colors. */
+	readonly palette: Uint16Array;
+	/**
+	 * Sets up a background layer, replacing any background previously set up on it.
+	 * Affine and extended backgrounds need a video mode that supports them on the layer, see `Video.main.setMode()`.
+	 * @param layer Layer 0-3. Only text backgrounds can use layers 0 and 1.
+	 * @param type Text backgrounds are 256 or 512 pixels wide and tall. Affine and extended backgrounds are square, from 128 to 1024 pixels.
+	 * `bitmap16` backgrounds are 128x128, 256x256, 512x256 or 512x512, and `bitmap8` backgrounds can also be 1024x512 or 512x1024.
+	 * @param mapBase Location of the map in background memory, in 2KB steps (0-31). For bitmap backgrounds, location of the bitmap in 16KB steps.
+	 * @param tileBase Location of the tileset in background memory, in 16KB steps (0-15).
+	 * For bitmap backgrounds, the optional location of a second page in 16KB steps, which makes the background double buffered.
+	 * Drawing then goes to the hidden page, and `Bitmap.present()` shows it at the next vblank.
+	 */
+	init(layer: 0 | 1 | 2 | 3, type: BackgroundType, width: number, height: number, mapBase: number, tileBase?: number): Background;
+}
+declare var Background: {
+	prototype: Background;
+	main: BackgroundEngine;
+	sub: BackgroundEngine;
+};
+
+/**
+ * Pixels drawn natively in memory. The bitmap of a background is copied to it when flushed, only covering the area changed since the last flush.
+ * 
+ * Colors are palette indices in 8bpp bitmaps. In 16bpp bitmaps they are 15-bit colors, which bitmap backgrounds only show with bit 15 set.
+ * Drawing is clipped to the bitmap.
+ */
+interface Bitmap {
+	readonly width: number;
+	readonly height: number;
+	readonly colorFormat: 8 | 16;
+	/**
+	 * Whether the bitmap of a background is flushed automatically after every frame's tasks. Defaults to `true`.
+	 * Double buffered backgrounds are also presented when there were changes.
+	 */
+	autoFlush: boolean;
+	/** Returns the color of a pixel, or `0` outside the bitmap. */
+	getPixel(x: number, y: number): number;
+	setPixel(x: number, y: number, color: number): void;
+	/** Fills the whole bitmap with a color, `0` by default. */
+	clear(color?: number): void;
+	fillRect(x: number, y: number, width: number, height: number, color: number): void;
+	/** Draws the one pixel wide outline of a rectangle. */
+	strokeRect(x: number, y: number, width: number, height: number, color: number): void;
+	drawLine(x0: number, y0: number, x1: number, y1: number, color: number): void;
+	fillCircle(x: number, y: number, radius: number, color: number): void;
+	strokeCircle(x: number, y: number, radius: number, color: number): void;
+	/** Fills the area of same colored pixels connected to a point. */
+	floodFill(x: number, y: number, color: number): void;
+	/**
+	 * Copies an area of a bitmap with the same color format onto this one.
+	 * @param colorKey A color left out of the copy, to draw through. By default every pixel is copied.
+	 * @param sx X position of the area in the source. Defaults to `0`.
+	 * @param sy Y position of the area in the source. Defaults to `0`.
+	 * @param width Defaults to the rest of the source's width.
+	 * @param height Defaults to the rest of the source's height.
+	 */
+	blit(source: Bitmap, x: number, y: number, colorKey?: number, sx?: number, sy?: number, width?: number, height?: number): void;
+	/**
+	 * Draws an 8bpp bitmap onto this 16bpp bitmap, looking up the colors of its pixels in a palette. The colors are drawn opaque.
+	 * @param colorKey A palette index left out of the copy, to draw through. By default every pixel is drawn.
+	 */
+	blitPalette(source: Bitmap, palette: Uint16Array, x: number, y: number, colorKey?: number, sx?: number, sy?: number, width?: number, height?: number): void;
+	/**
+	 * Copies pixels from an array into an area of the bitmap. The array holds 16-bit colors for 16bpp bitmaps, or palette indices for 8bpp bitmaps.
+	 * @param data Rows of pixels, `stride` pixels apart.
+	 * @param width Width of the area in pixels.
+	 * @param height Height of the area in pixels. Defaults to as many whole rows as `data` holds.
+	 * @param stride Pixels from the start of one row in `data` to the next. Defaults to `width`.
+	 * @throws If `data` doesn't match the color format or doesn't hold enough pixels.
+	 */
+	putImageData(data: Uint16Array | Uint8Array, x: number, y: number, width: number, height?: number, stride?: number): void;
+	/**
+	 * Copies an area of the bitmap into an array, row by row. Pixels outside the bitmap are read as `0`.
+	 * @param data An array to copy into. By default a new one is created.
+	 * @returns A `Uint16Array` for 16bpp bitmaps or a `Uint8Array` for 8bpp bitmaps, or `data` if given.
+	 * @throws If `data` doesn't match the color format or is too small for the area.
+	 */
+	getImageData(x: number, y: number, width: number, height: number, data?: Uint16Array | Uint8Array): Uint16Array | Uint8Array;
+	/** Copies the changed area to the background showing this bitmap, if any. With a double buffered background, this is the hidden page. */
+	flush(): void;
+	/**
+	 * Flushes to the hidden page of a double buffered background, and shows that page from the next vblank.
+	 * @returns A promise that resolves once the page is shown, to pace drawing with.
+	 * @throws If this bitmap isn't shown on a double buffered background.
+	 */
+	present(): Promise<void>;
+}
+declare var Bitmap: {
+	prototype: Bitmap;
+	/**
+	 * Creates a bitmap that isn't shown on a background, i.e. to blit from.
+	 * @param width Width in pixels, up to 1024.
+	 * @param height Height in pixels, up to 1024.
+	 * @param colorFormat Defaults to `16`.
+	 */
+	new(width: number, height: number, colorFormat?: 8 | 16): Bitmap;
+};
+
+/**
+ * Writes a register from a table of values, one for each line of the screen, during the hblank before that line.
+ * The table is copied at the start of every vblank, so it can be changed at any time to take effect on the next frame.
+ * While enabled, the register's normal value (i.e. a background's scroll) is overridden.
+ */
+interface HBlankEffect {
+	/** Whether the table is being applied. Up to 16 effects can be enabled at once. */
+	enabled: boolean;
+	readonly table: Int16Array | Uint16Array | Int32Array | Uint32Array;
+}
+declare var HBlankEffect: {
+	prototype: HBlankEffect;
+	/**
+	 * Creates an effect and enables it.
+	 * @param target A background, or `Background.main` or `Background.sub` for registers of the whole engine.
+	 * @param property For text backgrounds, `x` or `y` scroll. For affine, extended and bitmap backgrounds, `x` or `y` of the reference point,
+	 * in pixels with 8 fractional bits, or `pa`, `pb`, `pc` or `pd` of the affine matrix.
+	 * For engines, the `backdrop` color, `blendAlpha` and `blendBrightness` coefficients, or `masterBrightness`.
+	 * @param table 192 entries, an `Int32Array` or `Uint32Array` for affine reference points and an `Int16Array` or `Uint16Array` otherwise.
+	 * @throws If the target has no such property, the table is the wrong type or too short, or too many effects are enabled.
+	 */
+	new(target: Background | BackgroundEngine, property: string, table: Int16Array | Uint16Array | Int32Array | Uint32Array): HBlankEffect;
+};
+
 /** An object associated with some allocated graphics memory. Can supply its graphics to one or more sprites. */
 interface SpriteGraphic {
 	/** Bitdepth of the graphics. If the value is `16` the image is a bitmap, otherwise it is paletted. */
@@ -675,8 +877,17 @@ interface SpriteGraphic {
 	readonly width: number;
 	/** Height in pixels of the graphics data. */
 	readonly height: number;
-	/** A `Uint8Array` providing direct access to the allocated graphics memory. */
+	/**
+	 * A `Uint8Array` providing direct access to the allocated graphics memory.
+	 * 
+	 * Defragmenting moves the graphics, which replaces this array and detaches the previous one.
+	 */
 	readonly data: Uint8Array;
+	/**
+	 * When `true`, touches only hit sprites showing this graphic on its opaque pixels, rather than anywhere in their box.
+	 * Ignored for graphics on engines using 2D mapping. Defaults to `false`.
+	 */
+	touchMask: boolean;
 	/** Frees the graphics memory associated with this object. This object is rendered useless and will error upon further usage. */
 	remove(): void;
 }
@@ -691,6 +902,8 @@ type SpriteGraphicFromColorFormat<C extends SpriteGraphic["colorFormat"]> =
 	SpriteGraphic;
 /** An affine matrix object that controls sprite transformations. Can be applied to one or more sprites to transform them all together. */
 interface SpriteAffineMatrix {
+	/** The affine matrix slot (0-31) on its engine. */
+	readonly id: number;
 	/** X position for the horizontal unit vector. `1` in the identity matrix. */
 	hdx: number;
 	/** Y position for the horizontal unit vector. `0` in the identity matrix. */
@@ -712,15 +925,59 @@ interface SpriteAffineMatrix {
 declare var SpriteAffineMatrix: {
 	prototype: SpriteAffineMatrix;
 };
-/** An object asssociated with a given sprite slot. */
-interface Sprite {
+/**
+ * A sequence of sprite graphics, played natively on any sprites it's attached to through `Sprite.animation`.
+ * Every frame must be from the same engine, and either all bitmap or all paletted graphics.
+ */
+interface SpriteAnimation {
+	/** The number of frames. */
+	readonly length: number;
+	/**
+	 * What happens after the last frame.
+	 * `"loop"` starts over, `"once"` stays on the last frame and fires `animationend` on the sprite,
+	 * and `"pingpong"` plays the frames backward and forward.
+	 */
+	readonly mode: "loop" | "once" | "pingpong";
+	readonly main: boolean;
+}
+declare var SpriteAnimation: {
+	prototype: SpriteAnimation;
+	/**
+	 * @param frames The graphics to show, in order.
+	 * @param durations How many frames (vblanks) each graphic is shown for, either once for all of them or per graphic.
+	 * @param mode What happens after the last frame. Defaults to `"loop"`.
+	 */
+	new(frames: SpriteGraphic[], durations: number | number[], mode?: "loop" | "once" | "pingpong"): SpriteAnimation;
+};
+interface SpriteEventMap {
+	"animationend": Event;
+	"touchstart": TouchEvent;
+	"touchmove": TouchEvent;
+	"touchend": TouchEvent;
+}
+/**
+ * An object asssociated with a given sprite slot.
+ * 
+ * Touches that start on a sprite of the bottom screen engine with touch event listeners are dispatched to the topmost one first,
+ * including its later `touchmove` and `touchend` events, and then to the global scope.
+ * Hits follow the sprite's box, affine matrix, and optionally its graphic's `touchMask`.
+ */
+interface Sprite extends EventTarget {
+	/** The sprite slot (0-127, or 0-511 when multiplexing) on its engine. Used to refer to the sprite in `SpriteEngine.updateBatch()`. */
+	readonly id: number;
 	/** Screen x position for the left edge of the sprite. */
 	x: number;
 	/** Screen y position for the top edge of the sprite. */
 	y: number;
 	setPosition(x: number, y: number): void;
-	/** A graphics object linking to allocated graphics memory. */
+	/** A graphics object linking to allocated graphics memory. While animating, this is the current frame's graphic. Setting it stops the animation. */
 	gfx: SpriteGraphic;
+	/** An animation to play on this sprite, starting from its first frame. `null` when not animating. */
+	animation: SpriteAnimation | null;
+	/** The index of the animation frame being shown. */
+	animationFrame: number;
+	/** Whether the animation is advancing. Becomes `false` at the end of a `"once"` animation, and setting it back to `true` starts it over. */
+	animationPlaying: boolean;
 	/** Rendering priority relative to other sprites. 0 = top, 3 = bottom. */
 	priority: 0 | 1 | 2 | 3;
 	/** Makes the sprite invisible. */
@@ -739,8 +996,35 @@ interface Sprite {
 	sizeDouble: boolean;
 	/** Enables mosaic mode for this sprite. Uses the mosaic size from the corresponding sprite engine. */
 	mosaic: boolean;
+	/** Depth used when the engine's `sortMode` is `"z"`. Sprites with higher values are drawn in front. Defaults to `0`. */
+	z: number;
+	/**
+	 * Horizontal velocity in pixels per frame. Setting any motion property makes the sprite move natively every frame,
+	 * keeping fractional positions, until `stop()` is called.
+	 */
+	vx: number;
+	/** Vertical velocity in pixels per frame. */
+	vy: number;
+	/** Horizontal acceleration in pixels per frame, added to `vx` every frame. */
+	ax: number;
+	/** Vertical acceleration in pixels per frame, added to `vy` every frame. */
+	ay: number;
+	/** Portion of velocity lost every frame, from `0` (none, the default) to `1`. */
+	friction: number;
+	/**
+	 * Keeps the moving sprite within an area of the screen.
+	 * @param mode `"clamp"` stops the sprite at the edges (the default), `"wrap"` brings it back in from the opposite edge once it's fully out,
+	 * and `"bounce"` reverses its velocity at the edges.
+	 */
+	setBounds(left: number, top: number, right: number, bottom: number, mode?: "clamp" | "wrap" | "bounce"): void;
+	/** Stops moving the sprite, clearing its velocity, acceleration, friction, and bounds. */
+	stop(): void;
 	/** Clears the sprite slot associated with this object and marks it as open. This object is rendered useless and will error upon further usage. */
 	remove(): void;
+	addEventListener<K extends keyof SpriteEventMap>(type: K, listener: (this: Sprite, ev: SpriteEventMap[K]) => any, options?: AddEventListenerOptions): void;
+	addEventListener(type: string, listener: EventListener, options?: AddEventListenerOptions): void;
+	removeEventListener<K extends keyof SpriteEventMap>(type: K, listener: (this: Sprite, ev: SpriteEventMap[K]) => any): void;
+	removeEventListener(type: string, listener: EventListener): void;
 }
 /** Sprites using paletted graphics. */
 interface PalettedSprite extends Sprite {
@@ -772,8 +1056,13 @@ interface SpriteEngine<M> {
 	 * For 2D-mapped paletted sprites, this must be `32`.
 	 * For 1D-mapped paletted sprites, this should be `32`, `64`, `128`, or `256`.
 	 * @param useExtendedPalettes Enable use of extended sprite palettes for 8 BPP graphics.
+	 * @param multiplex Allow up to 512 sprites by reusing hardware sprites further down the screen.
+	 * Sprites are sorted by Y when committed, and up to 128 can overlap any line.
+	 * Past that, sprites lower on the screen start drawing late. Fewer sprite pixels can be drawn per line in this mode.
+	 * 
+	 * Sprites and graphics added before reinitializing are removed.
 	 */
-	init(allowBitmaps?: boolean, use2DMapping?: boolean, boundarySize?: 32 | 64 | 128 | 256, useExtendedPalettes?: boolean): void;
+	init(allowBitmaps?: boolean, use2DMapping?: boolean, boundarySize?: 32 | 64 | 128 | 256, useExtendedPalettes?: boolean, multiplex?: boolean): void;
 	/** Enables sprite rendering from this engine. */
 	enable(): void;
 	/** Disables sprite rendering from this engine. */
@@ -800,9 +1089,26 @@ interface SpriteEngine<M> {
 	 * @param height Height of the graphics. May be rounded up to the nearest valid size. Maximum is 64.
 	 * @param colorFormat Bitdepth of the graphics. `16` bits per pixel graphics are bitmap, otherwise the graphics are paletted.
 	 * @param data An optional `TypedArray` that will be copied into the newly allocated graphics data.
+	 * @param compressed Whether `data` is LZ77, Huffman, or RLE compressed, in the format used by the DS BIOS. It is decompressed straight into graphics memory.
 	 * @returns A `SpriteGraphic` object which can be supplied when creating a sprite, or be assigned to an existing one. Can be shared across multiple sprites.
+	 * @throws If `compressed` is set and `data` isn't compressed, or decompresses to more than the graphic holds.
+	 */
+	addGraphic<C extends SpriteGraphic["colorFormat"]>(width: number, height: number, colorFormat: C, data?: TypedArray, compressed?: boolean): SpriteGraphicFromColorFormat<C> & MainEngine<M>;
+	/**
+	 * Allocates graphics memory and fills it straight from a file, without going through a `TypedArray`.
+	 * The data should be laid out like `SpriteGraphic.data`.
+	 * @param path Path of the file to read.
+	 * @param offset Byte offset of the graphics data in the file.
+	 * @param compressedSize When given, the data is this many bytes compressed like in `addGraphic()`, and decompressed straight into graphics memory.
+	 * @throws If the file can't be opened or doesn't hold enough data.
+	 */
+	loadGraphic<C extends SpriteGraphic["colorFormat"]>(path: string, offset: number, width: number, height: number, colorFormat: C, compressedSize?: number): SpriteGraphicFromColorFormat<C> & MainEngine<M>;
+	/**
+	 * Loads several graphics of the same size from a file, stored one after another starting at `offset`.
+	 * @param count Number of graphics to load, up to 1024.
+	 * @throws If the file can't be opened or doesn't hold enough data, in which case no graphics are kept.
 	 */
-	addGraphic<C extends SpriteGraphic["colorFormat"]>(width: number, height: number, colorFormat: C, data?: TypedArray): SpriteGraphicFromColorFormat<C> & MainEngine<M>;
+	loadSheet<C extends SpriteGraphic["colorFormat"]>(path: string, offset: number, width: number, height: number, colorFormat: C, count: number): (SpriteGraphicFromColorFormat<C> & MainEngine<M>)[];
 	/**
 	 * Adds a new affine matrix on this sprite engine that can transform sprites.
 	 * @param hdx X position for the horizontal unit vector. Defaults to `1`.
@@ -812,6 +1118,48 @@ interface SpriteEngine<M> {
 	 * @returns A `SpriteAffineMatrix` object which can be supplied when creating a sprite, or be assigned to an existing one. Can be shared across multiple sprites.
 	 */
 	addAffineMatrix(hdx?: number, hdy?: number, vdx?: number, vdy?: number): SpriteAffineMatrix & MainEngine<M>;
+	/**
+	 * Whether sprite changes are committed automatically once every frame's tasks have run. Defaults to `true`.
+	 * 
+	 * When `false`, changes only become visible after calling `commit()`.
+	 */
+	autoCommit: boolean;
+	/**
+	 * The order sprites are drawn in, applied natively when committing. Sprite IDs are unaffected.
+	 * - `"none"`: sprites with lower IDs are drawn in front. This is the default.
+	 * - `"priority"`: sprites with lower `priority` are drawn in front, then by ID.
+	 * - `"y"`: by priority, then sprites whose bottom edge is lower on the screen are drawn in front.
+	 * - `"z"`: by priority, then sprites with higher `z` are drawn in front.
+	 * 
+	 * Multiplexed engines order sprites by their position on screen instead.
+	 */
+	sortMode: "none" | "priority" | "y" | "z";
+	/**
+	 * When multiplexing, the number of visible sprites left out of the last commit because every hardware sprite was in use to the bottom of the screen.
+	 * Sprites in a band with over 128 of them can also start a few lines late. Always `0` when not multiplexing.
+	 */
+	readonly droppedSprites: number;
+	/**
+	 * Moves all sprite graphics together to free up contiguous graphics memory.
+	 * This also happens automatically when `addGraphic()` can't otherwise find room.
+	 * @throws If the engine was initialized with 2D mapping.
+	 */
+	defragment(): void;
+	/**
+	 * Commits all current sprite changes as one frame, to be displayed from the next vblank.
+	 * Changes made afterwards won't show until they are committed as well.
+	 */
+	commit(): void;
+	/**
+	 * Updates many sprites at once.
+	 * 
+	 * Each sprite takes 6 consecutive entries in `fields`: x, y, priority, palette (or alpha), hidden (nonzero hides),
+	 * and the ID of the affine matrix slot to use (`-1` for none).
+	 * @param ids The `id`s of the sprites to update, in the same order as `fields`.
+	 * When `null`, `fields` is a table of sprite slots starting from 0, and unused slots are skipped.
+	 * @throws If a sprite or affine matrix ID is not in use on this engine.
+	 */
+	updateBatch(ids: Uint8Array | Uint16Array | null, fields: Int16Array): void;
 	/**
 	 * Sets the engine-wide mosaic values for sprites that have mosaic mode enabled.
 	 */
@@ -844,6 +1192,86 @@ declare var Sprite: {
 	sub: SpriteEngine<false>;
 };
 
+interface CollideEvent extends Event {
+	/** ID of the first body. */
+	readonly a: number;
+	/** ID of the second body. */
+	readonly b: number;
+}
+interface CollisionWorldEventMap {
+	"collide": CollideEvent;
+}
+/**
+ * A set of bodies, either sprites or boxes, checked for overlaps natively every frame after sprites update.
+ * Two bodies collide when each one's `layer` shares a bit with the other's `mask`.
+ */
+interface CollisionWorld extends EventTarget {
+	/**
+	 * Adds a body that follows a sprite's position and size. Hidden and removed sprites don't collide.
+	 * @param layer Bits of the layers the body is in. Defaults to `1`.
+	 * @param mask Bits of the layers the body collides with. Defaults to all of them.
+	 * @returns The ID of the new body.
+	 */
+	addSprite(sprite: Sprite, layer?: number, mask?: number): number;
+	/**
+	 * Adds a body with a fixed box, in screen pixels.
+	 * @returns The ID of the new body.
+	 */
+	addBox(x: number, y: number, width: number, height: number, layer?: number, mask?: number): number;
+	/** Moves or resizes a box body. */
+	setBox(id: number, x: number, y: number, width: number, height: number): void;
+	setLayers(id: number, layer: number, mask: number): void;
+	/** Removes a body. Its ID may be reused by a body added later. */
+	remove(id: number): void;
+	/** Checks for overlaps right away, rather than waiting for the next frame. */
+	update(): void;
+	/** IDs of overlapping bodies from the last check, two per pair. */
+	readonly pairs: Uint16Array;
+	addEventListener<K extends keyof CollisionWorldEventMap>(type: K, listener: (this: CollisionWorld, ev: CollisionWorldEventMap[K]) => any, options?: AddEventListenerOptions): void;
+	addEventListener(type: string, listener: EventListener, options?: AddEventListenerOptions): void;
+	removeEventListener<K extends keyof CollisionWorldEventMap>(type: K, listener: (this: CollisionWorld, ev: CollisionWorldEventMap[K]) => any): void;
+	removeEventListener(type: string, listener: EventListener): void;
+}
+declare var CollisionWorld: {
+	prototype: CollisionWorld;
+	/** @param cellSize Size in pixels of the grid cells bodies are sorted into, 8 to 256. Defaults to `32`. */
+	new(cellSize?: number): CollisionWorld;
+};
+
+/**
+ * Colors for the four shades of a font: background, two blend levels, and text color.
+ * For paletted targets these are palette indices. A zero is left transparent.
+ * A single color is used as the text color over a transparent background.
+ */
+type TextPalette = number | string | ArrayLike<number | string>;
+/** A target for text drawing. Typed arrays are treated as 256 pixel wide bitmaps, `Uint8Array` being paletted. */
+type TextTarget = SpriteGraphic | Bitmap | Uint8Array | Uint16Array;
+/** A Nitro font, used for drawing text into graphics. */
+interface Font {
+	/** Height in pixels of a line of text. */
+	readonly height: number;
+	/** Returns the width in pixels of the longest line of the text. Results are cached per string. */
+	measure(text: string): number;
+	/**
+	 * Draws text into a graphics buffer. Line breaks return to the starting X position.
+	 * Pixels outside of the target are skipped.
+	 * @param palette Defaults to white for bitmaps, and index 1 for paletted targets.
+	 * @returns The width in pixels of the longest drawn line.
+	 * @throws If the target isn't supported.
+	 */
+	drawText(target: TextTarget, x: number, y: number, text: string, palette?: TextPalette): number;
+}
+declare var Font: {
+	prototype: Font;
+	/**
+	 * Loads an NFTR font file. Glyphs are read from the file as they're needed.
+	 * @throws If the file can't be opened or isn't a font.
+	 */
+	new(path: string): Font;
+	/** The font used by the console. */
+	readonly default: Font;
+};
+
 interface BetaAPI {
 	gfxInit(): void;
 	gfxRect(x: number, y: number, width: number, height: number, color: number): void;
@@ -0,0 +1,50 @@
+#ifndef JSDS_BACKGROUND_HPP
+#define JSDS_BACKGROUND_HPP
+
+#include <nds/arm9/background.h>
+#include "jerry/jerryscript.h"
+
+struct NativeBackgroundEngine {
+	static constexpr const char *name = "BackgroundEngine";
+	bool main;
+};
+struct NativeBitmap;
+struct NativeBackground {
+	static constexpr const char *name = "Background";
+	u8 id; // libnds background ID, which is 4-7 for the sub engine's layers
+	bool main;
+	bool removed; // another background was initialized on the same layer
+	bool hidden;
+	BgType type;
+	u16 width;
+	u16 height;
+	s32 x;
+	s32 y;
+	NativeBitmap *bitmap; // NULL for tiled backgrounds, kept alive by the background's "bitmap" internal
+	bool doubleBuffered;
+	u8 pageBases[2]; // bitmap bases of a double buffered background's pages, in 16KB steps
+	u8 frontPage;
+	bool swapPending; // pages are swapped at the next vblank
+	jerry_value_t presentPromise; // owned while a swap is pending, resolved once it's done
+
+	~NativeBackground();
+};
+
+// Backgrounds by libnds ID, NULL when not set up.
+extern NativeBackground *backgroundSlots[8];
+
+// Copies to VRAM, which can't be written a byte at a time. size should be a multiple of 2.
+void copyToVram(const void *src, void *dst, u32 size);
+// Gets the memory a bitmap background's bitmap is flushed to, which is the back page when double buffered.
+u16 *backgroundBitmapTarget(NativeBackground *bg);
+// Queues a swap of a double buffered background's pages. Returns a promise for the swap, which isn't acquired.
+jerry_value_t backgroundPresent(NativeBackground *bg);
+// Whether some double buffered background is waiting for its pages to be swapped.
+bool backgroundSwapPending();
+// Applies background scroll and affine changes, and swaps pending pages. Called during vblank.
+void backgroundUpdate();
+
+void exposeBackgroundAPI(jerry_value_t global);
+void releaseBackgroundReferences();
+
+#endif /* JSDS_BACKGROUND_HPP */
\ No newline at end of file
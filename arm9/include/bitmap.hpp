@@ -0,0 +1,47 @@
+#ifndef JSDS_BITMAP_HPP
+#define JSDS_BITMAP_HPP
+
+#include <nds/ndstypes.h>
+#include "jerry/jerryscript.h"
+
+// Area of a bitmap, empty when left >= right.
+struct BitmapRect {
+	u16 left;
+	u16 top;
+	u16 right;
+	u16 bottom;
+};
+/* Pixels drawn in memory, which are copied to the bitmap background showing them when flushed.
+ * Only the area changed since the last flush is copied.
+ */
+struct NativeBitmap {
+	static constexpr const char *name = "Bitmap";
+	u8 *pixels; // owned, rows of width pixels
+	u16 width;
+	u16 height;
+	u8 bpp; // exposed as colorFormat, 8 or 16
+	s8 background; // libnds ID of the background showing the bitmap, -1 if none
+	bool autoFlush; // flush after every frame's tasks
+	BitmapRect dirty; // changed since the last flush
+	// with a double buffered background, areas that are out of date on each page apart from the dirty area
+	BitmapRect backStale;
+	BitmapRect frontStale;
+
+	~NativeBitmap();
+};
+
+// Creates a blank Bitmap, or returns an error. Return value must be released!
+jerry_value_t bitmapCreate(u16 width, u16 height, u8 bpp);
+// Copies the changed area of a bitmap to its background, or to the back page of a double buffered background.
+void bitmapFlush(NativeBitmap *bitmap);
+// Called once the pages of a bitmap's double buffered background are swapped.
+void bitmapPagesSwapped(NativeBitmap *bitmap);
+// Grows the area of a bitmap to be flushed to cover a rectangle, clipped to the bitmap.
+void markDirty(NativeBitmap *bitmap, int x, int y, int width, int height);
+// Flushes the bitmaps of backgrounds with autoFlush set, presenting double buffered ones.
+void bitmapUpdate();
+
+void exposeBitmapAPI(jerry_value_t global);
+void releaseBitmapReferences();
+
+#endif /* JSDS_BITMAP_HPP */
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef JSDS_COLLISION_HPP
+#define JSDS_COLLISION_HPP
+
+#include <nds/ndstypes.h>
+#include "jerry/jerryscript.h"
+
+// Finds the overlapping bodies of every collision world, from the sprite positions about to be committed.
+void collisionUpdate();
+// Listener count of a collision world, or NULL if target isn't one.
+u16 *collisionListenerCount(jerry_value_t target);
+
+void exposeCollisionAPI(jerry_value_t global);
+void releaseCollisionReferences();
+
+#endif /* JSDS_COLLISION_HPP */
\ No newline at end of file
@@ -17,6 +17,8 @@ extern bool inREPL;
 extern bool abortFlag;
 extern bool userClosed;
 extern u8 dependentEvents;
+// Listeners on native objects such as sprites, whose events keep the event loop running.
+extern u32 nativeListeners;
 
 enum DependentEvent {
 	vblank     = BIT(0),
@@ -39,6 +41,9 @@ void runParsedCodeTask(const jerry_value_t *args, u32 argCount);
 jerry_value_t createEvent(jerry_value_t type, bool cancelable);
 jerry_value_t createEvent(const char *type, bool cancelable);
 bool dispatchEvent(jerry_value_t target, jerry_value_t event, bool sync);
+bool hasEventListeners(jerry_value_t target, const char *type);
+// Stops counting a native object's listeners toward keeping the event loop running, once it can't fire events anymore.
+void releaseNativeListeners(u16 &listenerCount);
 void queueEvent(jerry_value_t target, jerry_value_t event, jerry_external_handler_t callback = NULL);
 void queueEventName(const char *eventName, jerry_external_handler_t callback = NULL);
 
@@ -0,0 +1,30 @@
+#ifndef JSDS_HBLANK_HPP
+#define JSDS_HBLANK_HPP
+
+#include <nds/ndstypes.h>
+#include "jerry/jerryscript.h"
+
+/* Table of values for a display register, one per line of the screen.
+ * The table is copied at the start of every vblank, so scripts can change it while the frame is drawn.
+ */
+struct NativeHBlankEffect {
+	static constexpr const char *name = "HBlankEffect";
+	jerry_value_t object; // only owned while enabled
+	jerry_value_t table; // owned
+	volatile void *target; // register written every hblank
+	bool wide; // 32-bit register, with an Int32Array or Uint32Array table
+	bool enabled;
+	u32 values[192]; // read by the HBlank interrupt, as halfwords unless wide
+
+	~NativeHBlankEffect();
+};
+
+// Enables the HBlank interrupt while either effects or sprite multiplexing need it.
+void hblankInterruptUpdate();
+// Copies the tables of enabled effects for the next frame. Called during vblank.
+void hblankUpdate();
+
+void exposeHBlankAPI(jerry_value_t global);
+void releaseHBlankReferences();
+
+#endif /* JSDS_HBLANK_HPP */
\ No newline at end of file
@@ -21,5 +21,17 @@ void consoleResume();
 void consoleClean();
 void consoleShrink();
 void consoleExpand();
+// Moves the view back through history (or forward, if negative) by some number of lines.
+void consoleScroll(int lines);
+// Handles scrolling input, call once per frame.
+void consoleUpdate();
+
+// Mirrors console output into a file (or stops mirroring if path is NULL). Returns false if the file couldn't be opened, leaving the current log as it was.
+bool consoleSetLogFile(const char *path);
+const char *consoleGetLogFile();
+// Writes all buffered log output to the file.
+void consoleLogFlush();
+// Writes out some buffered log output, call once per frame.
+void consoleLogUpdate();
 
 #endif /* JSDS_CONSOLE_HPP */
\ No newline at end of file
@@ -1,9 +1,119 @@
 #ifndef JSDS_SPRITE_HPP
 #define JSDS_SPRITE_HPP
 
+#include <nds/arm9/sprite.h>
+#include <vector>
 #include "jerry/jerryscript.h"
+#include "util/helpers.hpp"
 
+// Order sprites are drawn in when committed, front to back. Every mode but none keeps lower priority values in front.
+enum SpriteSort : u8 {
+	SORT_NONE, // by ID
+	SORT_PRIORITY,
+	SORT_Y, // lower bottom edges in front
+	SORT_Z // higher z in front
+};
+struct NativeSpriteEngine {
+	static constexpr const char *name = "SpriteEngine";
+	bool main;
+	bool autoCommit; // commit after every frame's tasks
+	SpriteSort sort;
+};
+enum MotionBounds : u8 {
+	BOUNDS_NONE,
+	BOUNDS_CLAMP, // stops at the edges
+	BOUNDS_WRAP, // comes back in from the opposite edge once fully out
+	BOUNDS_BOUNCE // reverses direction at the edges
+};
+// Sprite motion integrated once per frame. Values are fixed point with 8 fractional bits, in pixels and frames.
+struct SpriteMotion {
+	s32 x;
+	s32 y;
+	s32 vx;
+	s32 vy;
+	s32 ax;
+	s32 ay;
+	s32 friction; // portion of velocity lost every frame
+	MotionBounds bounds;
+	s16 left;
+	s16 top;
+	s16 right;
+	s16 bottom;
+};
+struct NativeSpriteGraphic;
+struct NativeSpriteAnimation;
+struct NativeSprite {
+	static constexpr const char *name = "Sprite";
+	u16 id;
+	bool main;
+	bool removed;
+	bool flipH;
+	bool flipV;
+	bool sizeDouble;
+	int affineID; // -1 when not using an affine matrix
+	s16 z;
+	NativeSpriteGraphic *graphic; // kept alive by the sprite's "gfx" internal
+	jerry_value_t object; // owned until removed, so sprites keep animating and moving without a script holding onto them
+	NativeSpriteAnimation *animation; // NULL when not animated, kept alive by the sprite's "animation" internal
+	u16 animationFrame;
+	u16 frameTime; // vblanks left on the current frame
+	bool animationPlaying;
+	bool animationReverse; // heading back toward the first frame, in pingpong mode
+	SpriteMotion *motion; // owned, NULL until a motion property is set and once removed
+	u16 listenerCount; // event listeners, which keep the event loop running until removed
+
+	~NativeSprite();
+};
+struct NativeSpriteGraphic {
+	static constexpr const char *name = "SpriteGraphic";
+	bool main;
+	bool removed;
+	SpriteSize size;
+	u8 bpp; // exposed as colorFormat
+	u8 width;
+	u8 height;
+	u16 *gfx; // moves when sprite graphics memory is defragmented
+	u32 byteSize;
+	jerry_value_t data; // Uint8Array over gfx
+	bool touchMask; // touches only hit opaque pixels
+
+	~NativeSpriteGraphic();
+};
+enum AnimationMode : u8 {
+	ANIMATION_LOOP,
+	ANIMATION_ONCE,
+	ANIMATION_PINGPONG
+};
+struct AnimationFrame {
+	NativeSpriteGraphic *graphic;
+	jerry_value_t graphicObj; // owned
+	u16 duration; // in vblanks
+};
+struct NativeSpriteAnimation {
+	static constexpr const char *name = "SpriteAnimation";
+	bool main;
+	AnimationMode mode;
+	std::vector<AnimationFrame> frames;
+
+	~NativeSpriteAnimation();
+};
+struct NativeSpriteAffineMatrix {
+	static constexpr const char *name = "SpriteAffineMatrix";
+	u8 id;
+	bool main;
+	bool removed;
+};
+
+// Gets the screen area covered by a sprite, or returns false if it's hidden or removed.
+bool spriteGetBounds(NativeSprite *sprite, s16 *x, s16 *y, u16 *width, u16 *height);
+// Finds the topmost sprite on the bottom screen at a point, among those listening for touch events. Returns NULL if there is none.
+NativeSprite *spriteTouchTarget(int x, int y);
+// Advances sprite animations, then commits sprites of engines with autoCommit set, to be copied to OAM on the next vblank.
 void spriteUpdate();
+// Applies multiplexed sprite changes for the current line. Called from the HBlank interrupt.
+void spriteHBlank();
+// Whether either engine is multiplexing sprites.
+bool spriteMultiplexing();
 
 void exposeSpriteAPI(jerry_value_t global);
 void releaseSpriteReferences();
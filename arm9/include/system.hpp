@@ -8,5 +8,6 @@ void queueTouchEvents();
 void queueSleepEvent();
 
 void exposeSystemAPI(jerry_value_t global);
+void releaseSystemReferences();
 
 #endif /* JSDS_SYSTEM_HPP */
\ No newline at end of file
@@ -0,0 +1,9 @@
+#ifndef JSDS_TEXT_HPP
+#define JSDS_TEXT_HPP
+
+#include "jerry/jerryscript.h"
+
+void exposeTextAPI(jerry_value_t global);
+void releaseTextReferences();
+
+#endif /* JSDS_TEXT_HPP */
\ No newline at end of file
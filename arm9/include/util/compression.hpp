@@ -0,0 +1,21 @@
+#ifndef JSDS_COMPRESSION_HPP
+#define JSDS_COMPRESSION_HPP
+
+#include <nds/ndstypes.h>
+
+// Formats the BIOS can decompress, identified by the high nibble of the first header byte.
+enum CompressionType : u8 {
+	COMPRESSION_LZ77 = 0x10,
+	COMPRESSION_HUFFMAN = 0x20,
+	COMPRESSION_RLE = 0x30
+};
+
+// Gets the size of compressed data once decompressed, or 0 if it isn't in a format the BIOS can decompress.
+u32 decompressedSize(const u8 *data, u32 size);
+/* Decompresses data into VRAM, or any memory that can't be written a byte at a time.
+ * dst must be word aligned, with room for decompressedSize() rounded up to a word.
+ * Returns false if unaligned data couldn't be copied for lack of memory.
+ */
+bool decompressVram(const u8 *data, u32 size, void *dst);
+
+#endif /* JSDS_COMPRESSION_HPP */
\ No newline at end of file
@@ -2,12 +2,28 @@
 #define JSDS_FONT_HPP
 
 #include <nds/ndstypes.h>
+#include <stdio.h>
 
 
 
 #define CHAR_RANGE 0x10000
+#define CHAR_PAGE_SIZE 0x100
+#define CHAR_PAGE_COUNT (CHAR_RANGE / CHAR_PAGE_SIZE)
 #define REPLACEMENT_CHAR 0xFFFD
 #define NO_TILE 0xFFFF
+#define GLYPH_PAGE_TILES 32
+#define GLYPH_CACHE_PAGES 16
+
+// Glyph pages of a font being read from a file as they're needed.
+struct NitroFontStream {
+	FILE *file;
+	u32 tileDataOffset;
+	u32 tileCount;
+	u8 *pages;
+	u16 pageNums[GLYPH_CACHE_PAGES];
+	u32 lastUsed[GLYPH_CACHE_PAGES];
+	u32 useCount;
+};
 
 struct NitroFont {
 	u8 tileWidth;
@@ -17,12 +33,25 @@ struct NitroFont {
 	u8 bitdepth;
 	bool replace;
 
-	u8 *tileData;
-	u8 *widthData;
+	const u8 *tileData; // NULL when streamed
+	const u8 *widthData;
+	/* Two-level map of codepoints to tile numbers.
+	 * The first CHAR_PAGE_COUNT entries are page numbers, followed by the pages of CHAR_PAGE_SIZE tile numbers.
+	 * Page 0 is empty (all NO_TILE) and shared by every codepoint range the font doesn't cover.
+	 */
 	u16 *charMap;
+	NitroFontStream *stream;
 };
 
+// Loads a font from resident NFTR data, which is used in place and must not be freed.
 NitroFont fontLoad(const u8 *data);
+// Opens an NFTR file, keeping only recently used glyph pages in memory. charMap is NULL if it couldn't be loaded.
+NitroFont fontLoadFile(const char *path);
+void fontFree(NitroFont font);
+/* Returns a codepoint's 2bpp tile (tileWidth pixels per row), or NULL if the font can't draw it.
+ * widths is set to point at its left spacing, glyph width, and total advance.
+ */
+const u8 *fontGetGlyph(NitroFont font, char16_t codepoint, const u8 **widths);
 u8 fontGetCodePointWidth(NitroFont font, char16_t codepoint);
 void fontPrintCodePoint(NitroFont font, const u16 *palette, char16_t codepoint, u16 *buffer, u32 bufferWidth, u32 x, u32 y);
 void fontPrintUnicode(NitroFont font, const u16 *palette, const char16_t *codepoints, u16 *buffer, u32 bufferWidth, u32 x, u32 y, u32 maxWidth, bool scroll);
@@ -2,6 +2,9 @@
 #define JSDS_HELPERS_HPP
 
 #include <nds/ndstypes.h>
+#include <optional>
+#include <tuple>
+#include <type_traits>
 #include "jerry/jerryscript.h"
 
 
@@ -25,6 +28,9 @@
 // Require the function to be called as a constructor only.
 #define CONSTRUCTOR(name) if (isNewTargetUndefined()) return TypeError("Constructor '" #name "' cannot be invoked without 'new'.")
 
+// Clamps n between min and max. Arguments may be evaluated more than once.
+#define BOUND(n, min, max) ((n) < (min) ? (min) : (n) > (max) ? (max) : (n))
+
 // Constant JS values, these do not need to be freed and can be used without restraint.
 // The values are copied from JerryScript's internals, and would need to be updated if they change in the future (aka this is jank)
 
@@ -84,6 +90,29 @@ char *rawString(const jerry_value_t stringValue, jerry_size_t *stringSize = NULL
  */
 char *toRawString(const jerry_value_t value, jerry_size_t *stringSize = NULL);
 
+const jerry_length_t STRING_CHUNK_LENGTH = 64;
+/*
+ * Call handler(const char *chunk, jerry_size_t size) on consecutive UTF-8 pieces of a string value, without allocating.
+ * Pieces are at most STRING_CHUNK_LENGTH characters long and never split a surrogate pair.
+ */
+template <typename Handler>
+void forEachStringChunk(jerry_value_t stringValue, Handler handler) {
+	jerry_length_t length = jerry_get_string_length(stringValue);
+	char buffer[STRING_CHUNK_LENGTH * 3];
+	jerry_length_t start = 0;
+	while (start < length) {
+		jerry_length_t end = length - start > STRING_CHUNK_LENGTH ? start + STRING_CHUNK_LENGTH : length;
+		jerry_size_t size = jerry_substring_to_utf8_char_buffer(stringValue, start, end, (jerry_char_t *) buffer, sizeof(buffer));
+		// leave a trailing high surrogate for the next piece
+		if (end < length && size >= 3 && (u8) buffer[size - 3] == 0xED && ((u8) buffer[size - 2] & 0xF0) == 0xA0) {
+			size -= 3;
+			end--;
+		}
+		handler(buffer, size);
+		start = end;
+	}
+}
+
 // Print a string value.
 void printString(jerry_value_t stringValue);
 // Print any value as a string.
@@ -164,4 +193,203 @@ bool testProperty(jerry_value_t object, const char *property);
 bool testInternal(jerry_value_t object, jerry_value_t property);
 bool testInternal(jerry_value_t object, const char *property);
 
+/*
+ * Native-backed objects keep their state in a struct attached to the object, instead of in internal properties.
+ * The struct is owned by the object and deleted when the object is collected.
+ */
+template <typename T>
+inline const jerry_object_native_info_t nativeInfo = {.free_cb = [](void *native) { delete (T *) native; }};
+
+// Attaches a new native struct to object, which takes ownership of it.
+template <typename T>
+T *setNative(jerry_value_t object, T *native) {
+	jerry_set_object_native_pointer(object, native, &nativeInfo<T>);
+	return native;
+}
+// Returns the native struct of type T attached to object, or NULL if there is none.
+template <typename T>
+T *getNative(jerry_value_t object) {
+	void *native = NULL;
+	jerry_get_object_native_pointer(object, &native, &nativeInfo<T>);
+	return (T *) native;
+}
+
+// Gets the native struct of thisValue as name, or returns a TypeError if it doesn't have one.
+#define NATIVE_THIS(T, name) T *name = getNative<T>(thisValue); if (name == NULL) return TypeError("Illegal invocation.")
+
+template <typename M>
+jerry_value_t nativeToValue(const M &value) {
+	if constexpr (std::is_same_v<M, bool>) return jerry_create_boolean(value);
+	else if constexpr (std::is_array_v<M> || std::is_pointer_v<M>) return String(value);
+	else return jerry_create_number(value);
+}
+template <typename M>
+M nativeFromValue(jerry_value_t value) {
+	if constexpr (std::is_same_v<M, bool>) return jerry_value_to_boolean(value);
+	else if constexpr (std::is_floating_point_v<M>) {
+		if (jerry_value_is_number(value)) return jerry_get_number_value(value);
+		jerry_value_t number = jerry_value_to_number(value);
+		M result = jerry_get_number_value(number);
+		jerry_release_value(number);
+		return result;
+	}
+	else if constexpr (std::is_signed_v<M>) return jerry_value_as_int32(value);
+	else return jerry_value_as_uint32(value);
+}
+
+template <typename P> struct NativeMember;
+template <typename T, typename M> struct NativeMember<M T::*> {
+	using Struct = T;
+	using Type = M;
+};
+
+// Getter returning a member of the native struct.
+template <auto member>
+FUNCTION(nativeGetter) {
+	NATIVE_THIS(typename NativeMember<decltype(member)>::Struct, native);
+	return nativeToValue(native->*member);
+}
+// Setter converting its argument to the type of a member of the native struct.
+template <auto member>
+FUNCTION(nativeSetter) {
+	NATIVE_THIS(typename NativeMember<decltype(member)>::Struct, native);
+	native->*member = nativeFromValue<typename NativeMember<decltype(member)>::Type>(args[0]);
+	return JS_UNDEFINED;
+}
+
+// Defines a getter for a native struct member, i.e. defNativeGetter<&NativeFile::mode>(File.prototype, "mode")
+template <auto member>
+void defNativeGetter(jerry_value_t object, const char *property) {
+	defGetter(object, property, nativeGetter<member>);
+}
+template <auto member>
+void defNativeGetterSetter(jerry_value_t object, const char *property) {
+	defGetterSetter(object, property, nativeGetter<member>, nativeSetter<member>);
+}
+
+const char WAS_REMOVED[] = "Using a previously removed object.";
+
+template <typename T, typename = void> struct HasRemoved : std::false_type {};
+template <typename T> struct HasRemoved<T, std::void_t<decltype(T::removed)>> : std::true_type {};
+
+/*
+ * Bound argument that must be an object with a native struct T, which declares its type name as T::name.
+ * Objects with a removed member are rejected once removed.
+ */
+template <typename T>
+struct NativeArg {
+	jerry_value_t value;
+	T *native;
+	T *operator->() const { return native; }
+};
+
+// Conversion state shared by the arguments of a bound call.
+struct BoundArgError {
+	const char *expected;
+	bool removed;
+};
+// Returns the error for a failed argument conversion. Return value must be released!
+jerry_value_t boundArgError(BoundArgError error);
+
+template <typename A>
+struct BoundArg {
+	static const bool optional = false;
+	static A convert(jerry_value_t value, BoundArgError &error) {
+		return nativeFromValue<A>(value);
+	}
+};
+template <typename T>
+struct BoundArg<NativeArg<T>> {
+	static const bool optional = false;
+	static NativeArg<T> convert(jerry_value_t value, BoundArgError &error) {
+		T *native = getNative<T>(value);
+		if (native == NULL) error.expected = T::name;
+		else if constexpr (HasRemoved<T>::value) {
+			if (native->removed) error.removed = true;
+		}
+		return {value, native};
+	}
+};
+// Optional arguments are empty when undefined (or null, for objects).
+template <typename A>
+struct BoundArg<std::optional<A>> {
+	static const bool optional = true;
+	static std::optional<A> convert(jerry_value_t value, BoundArgError &error) {
+		if (jerry_value_is_undefined(value)) return std::nullopt;
+		if constexpr (!std::is_arithmetic_v<A>) {
+			if (jerry_value_is_null(value)) return std::nullopt;
+		}
+		return BoundArg<A>::convert(value, error);
+	}
+};
+
+// Number of arguments before the first optional one.
+template <typename... A>
+constexpr u32 requiredArgCount() {
+	u32 count = 0;
+	bool required[] = {!BoundArg<A>::optional..., false};
+	while (required[count]) count++;
+	return count;
+}
+
+/* Result of a bound function that is already a JS value, which is returned as it is.
+ * jerry_value_t is just a u32, so it can't be told apart from a number and isn't accepted as a result.
+ */
+struct JS_value {
+	jerry_value_t value;
+	JS_value(jerry_value_t value) : value(value) {}
+};
+
+// JS_value results are returned as they are, other results are converted.
+template <typename R>
+jerry_value_t boundResult(const R &result) {
+	static_assert(!std::is_same_v<R, jerry_value_t>, "Return JS_value for JS values, or a number type other than u32.");
+	if constexpr (std::is_same_v<R, JS_value>) return result.value;
+	else return nativeToValue(result);
+}
+
+template <typename R, typename... A, std::size_t... I, typename Call>
+jerry_value_t callBound(Call call, const jerry_value_t args[], u32 argCount, std::index_sequence<I...>) {
+	REQUIRE(requiredArgCount<A...>());
+	BoundArgError error = {NULL, false};
+	std::tuple<A...> converted{BoundArg<A>::convert(I < argCount ? args[I] : JS_UNDEFINED, error)...};
+	if (error.expected != NULL || error.removed) return boundArgError(error);
+	if constexpr (std::is_void_v<R>) {
+		std::apply(call, converted);
+		return JS_UNDEFINED;
+	}
+	else return boundResult(std::apply(call, converted));
+}
+
+template <typename F> struct Binding;
+template <typename R, typename... A>
+struct Binding<R (*)(A...)> {
+	template <auto bound>
+	static FUNCTION(handler) {
+		return callBound<R, A...>(bound, args, argCount, std::index_sequence_for<A...>());
+	}
+};
+template <typename R, typename T, typename... A>
+struct Binding<R (*)(T *, A...)> {
+	template <auto bound>
+	static FUNCTION(methodHandler) {
+		NATIVE_THIS(T, native);
+		if constexpr (HasRemoved<T>::value) {
+			if (native->removed) return TypeError(WAS_REMOVED);
+		}
+		return callBound<R, A...>([native](A... a) { return bound(native, a...); }, args, argCount, std::index_sequence_for<A...>());
+	}
+};
+
+/*
+ * JS function handler generated from a C++ function, with arity checks and conversions derived from its parameters.
+ * Parameters may be bools, numbers, NativeArg<T> objects, or std::optional of those for trailing optional arguments.
+ * Results may be void, bools, numbers, strings, or JS_value for values that are already JS values.
+ */
+template <auto bound>
+constexpr jerry_external_handler_t bindFunction = Binding<decltype(bound)>::template handler<bound>;
+// Same as bindFunction, but the first parameter receives the native struct of thisValue.
+template <auto bound>
+constexpr jerry_external_handler_t bindMethod = Binding<decltype(bound)>::template methodHandler<bound>;
+
 #endif /* JSDS_HELPERS_HPP */
\ No newline at end of file
@@ -1,10 +1,15 @@
+#include "background.hpp"
+#include "bitmap.hpp"
+#include "collision.hpp"
 #include "encoding.hpp"
 #include "event.hpp"
 #include "file.hpp"
+#include "hblank.hpp"
 #include "io.hpp"
 #include "io/keyboard.hpp"
 #include "sprite.hpp"
 #include "system.hpp"
+#include "text.hpp"
 #include "timeouts.hpp"
 #include "util/helpers.hpp"
 #include "video.hpp"
@@ -95,7 +100,12 @@ void exposeAPI() {
 	exposeEventAPI(ref_global);
 	exposeSystemAPI(ref_global);
 	exposeVideoAPI(ref_global);
+	exposeBackgroundAPI(ref_global);
+	exposeBitmapAPI(ref_global);
+	exposeHBlankAPI(ref_global);
 	exposeSpriteAPI(ref_global);
+	exposeCollisionAPI(ref_global);
+	exposeTextAPI(ref_global);
 
 	// gotta get rid of these soon
 	jerry_value_t beta = createObject(ref_global, "beta");
@@ -121,7 +131,13 @@ void releaseReferences() {
 
 	releaseIOReferences();
 	releaseEventReferences();
+	releaseSystemReferences();
 	releaseVideoReferences();
+	releaseBackgroundReferences();
+	releaseBitmapReferences();
 	releaseSpriteReferences();
+	releaseHBlankReferences();
+	releaseCollisionReferences();
 	releaseFileReferences();
+	releaseTextReferences();
 }
\ No newline at end of file
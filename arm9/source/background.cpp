@@ -0,0 +1,417 @@
+#include "background.hpp"
+
+#include <nds/arm9/cache.h>
+#include <nds/arm9/trig_lut.h>
+#include <nds/dma.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitmap.hpp"
+#include "util/compression.hpp"
+#include "util/helpers.hpp"
+
+
+
+JS_class ref_Background;
+NativeBackground *backgroundSlots[8] = {NULL};
+// the object of each background set up, held until its layer is set up again so the layer keeps working without it
+jerry_value_t backgroundObjects[8];
+
+NativeBackground::~NativeBackground() {
+	if (backgroundSlots[id] == this) backgroundSlots[id] = NULL;
+	if (swapPending) jerry_release_value(presentPromise);
+}
+
+/* DMA reads memory rather than the cache, so the source is flushed first.
+ * Sources that aren't halfword aligned can't be copied by DMA, and are put together a halfword at a time instead.
+ */
+void copyToVram(const void *src, void *dst, u32 size) {
+	if ((uintptr_t) src & 1) {
+		const u8 *bytes = (const u8 *) src;
+		u16 *halfwords = (u16 *) dst;
+		for (u32 i = 0; i < size / 2; i++) halfwords[i] = bytes[i * 2] | bytes[i * 2 + 1] << 8;
+		return;
+	}
+	DC_FlushRange(src, size);
+	dmaCopy(src, dst, size);
+}
+
+u16 *backgroundBitmapTarget(NativeBackground *bg) {
+	if (!bg->doubleBuffered) return bgGetGfxPtr(bg->id);
+	return (bg->main ? BG_GFX : BG_GFX_SUB) + bg->pageBases[bg->frontPage ^ 1] * 0x2000;
+}
+
+jerry_value_t backgroundPresent(NativeBackground *bg) {
+	if (!bg->swapPending) {
+		bg->swapPending = true;
+		bg->presentPromise = jerry_create_promise();
+	}
+	return bg->presentPromise;
+}
+
+bool backgroundSwapPending() {
+	for (NativeBackground *bg : backgroundSlots) {
+		if (bg != NULL && bg->swapPending) return true;
+	}
+	return false;
+}
+
+void backgroundUpdate() {
+	bgUpdate();
+	for (NativeBackground *bg : backgroundSlots) {
+		if (bg == NULL || !bg->swapPending) continue;
+		bg->frontPage ^= 1;
+		bgSetMapBase(bg->id, bg->pageBases[bg->frontPage]);
+		if (bg->bitmap != NULL) bitmapPagesSwapped(bg->bitmap);
+		bg->swapPending = false;
+		jerry_release_value(jerry_resolve_or_reject_promise(bg->presentPromise, JS_UNDEFINED, true));
+		jerry_release_value(bg->presentPromise);
+		bg->presentPromise = JS_UNDEFINED;
+	}
+}
+
+inline bool isTextBackground(NativeBackground *bg) {
+	return bg->type == BgType_Text4bpp || bg->type == BgType_Text8bpp;
+}
+inline bool isBitmapBackground(BgType type) {
+	return type == BgType_Bmp8 || type == BgType_Bmp16;
+}
+const char NO_TILES[] = "Bitmap backgrounds don't have tiles.";
+
+bool backgroundSize(BgType type, int width, int height, BgSize *size) {
+	if (type == BgType_Text4bpp || type == BgType_Text8bpp) {
+		if (width == 256 && height == 256) *size = BgSize_T_256x256;
+		else if (width == 512 && height == 256) *size = BgSize_T_512x256;
+		else if (width == 256 && height == 512) *size = BgSize_T_256x512;
+		else if (width == 512 && height == 512) *size = BgSize_T_512x512;
+		else return false;
+	}
+	else if (type == BgType_Bmp8) {
+		if (width == 128 && height == 128) *size = BgSize_B8_128x128;
+		else if (width == 256 && height == 256) *size = BgSize_B8_256x256;
+		else if (width == 512 && height == 256) *size = BgSize_B8_512x256;
+		else if (width == 512 && height == 512) *size = BgSize_B8_512x512;
+		else if (width == 1024 && height == 512) *size = BgSize_B8_1024x512;
+		else if (width == 512 && height == 1024) *size = BgSize_B8_512x1024;
+		else return false;
+	}
+	else if (type == BgType_Bmp16) {
+		if (width == 128 && height == 128) *size = BgSize_B16_128x128;
+		else if (width == 256 && height == 256) *size = BgSize_B16_256x256;
+		else if (width == 512 && height == 256) *size = BgSize_B16_512x256;
+		else if (width == 512 && height == 512) *size = BgSize_B16_512x512;
+		else return false;
+	}
+	else if (width != height) return false;
+	else if (width == 128) *size = type == BgType_Rotation ? BgSize_R_128x128 : BgSize_ER_128x128;
+	else if (width == 256) *size = type == BgType_Rotation ? BgSize_R_256x256 : BgSize_ER_256x256;
+	else if (width == 512) *size = type == BgType_Rotation ? BgSize_R_512x512 : BgSize_ER_512x512;
+	else if (width == 1024) *size = type == BgType_Rotation ? BgSize_R_1024x1024 : BgSize_ER_1024x1024;
+	else return false;
+	return true;
+}
+
+// Affine backgrounds have byte map entries, the others have halfword entries.
+u32 mapByteSize(NativeBackground *bg) {
+	u32 entries = (bg->width / 8) * (bg->height / 8);
+	return bg->type == BgType_Rotation ? entries : entries * 2;
+}
+// Tile data is limited by how many tiles map entries can refer to.
+u32 tilesByteSize(NativeBackground *bg) {
+	if (bg->type == BgType_Rotation) return 256 * 64;
+	if (bg->type == BgType_Text4bpp) return 1024 * 32;
+	return 1024 * 64;
+}
+
+/* Index of the map entry of a tile, wrapping around the map.
+ * Text backgrounds wider or taller than 256 pixels are made of 32x32 tile blocks.
+ */
+u32 mapIndex(NativeBackground *bg, int x, int y) {
+	u32 columns = bg->width / 8, rows = bg->height / 8;
+	u32 tx = ((x % (int) columns) + columns) % columns;
+	u32 ty = ((y % (int) rows) + rows) % rows;
+	if (!isTextBackground(bg)) return tx + ty * columns;
+	return ((ty / 32) * (columns / 32) + tx / 32) * 1024 + (ty % 32) * 32 + tx % 32;
+}
+u16 readMapEntry(NativeBackground *bg, u32 index) {
+	if (bg->type == BgType_Rotation) return ((u8 *) bgGetMapPtr(bg->id))[index];
+	return bgGetMapPtr(bg->id)[index];
+}
+void writeMapEntry(NativeBackground *bg, u32 index, u16 entry) {
+	u16 *map = bgGetMapPtr(bg->id);
+	if (bg->type == BgType_Rotation) {
+		u8 shift = (index & 1) * 8;
+		map[index / 2] = (map[index / 2] & ~(0xFF << shift)) | (entry & 0xFF) << shift;
+	}
+	else map[index] = entry;
+}
+
+// Copies a typed array into a region of VRAM, decompressing it first if compressed is set.
+jerry_value_t uploadToVram(jerry_value_t array, u32 offset, bool compressed, u8 *region, u32 regionSize) {
+	EXPECT(jerry_value_is_typedarray(array), TypedArray);
+	if (offset % (compressed ? 4 : 2) != 0) return RangeError(compressed ? "Expected an offset aligned to 4 bytes." : "Expected an offset aligned to 2 bytes.");
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(array, &byteOffset, &byteLength);
+	u8 *data = jerry_get_arraybuffer_pointer(arrayBuffer) + byteOffset;
+	jerry_release_value(arrayBuffer);
+	u32 room = offset < regionSize ? regionSize - offset : 0;
+	if (compressed) {
+		u32 size = decompressedSize(data, byteLength);
+		if (size == 0) return TypeError("Expected LZ77, Huffman, or RLE compressed data.");
+		if (((size + 3) & ~3) > room) return RangeError("Decompressed data is larger than the space after offset.");
+		if (!decompressVram(data, byteLength, region + offset)) return Error("Not enough memory to decompress the data.");
+	}
+	else {
+		if (byteLength > room) return RangeError("Data is larger than the space after offset.");
+		copyToVram(data, region + offset, byteLength & ~1);
+	}
+	return JS_UNDEFINED;
+}
+
+FUNCTION(BackgroundEngine_init) {
+	NATIVE_THIS(NativeBackgroundEngine, engine);
+	REQUIRE(5);
+	u32 layer = jerry_value_as_uint32(args[0]);
+	if (layer > 3) return RangeError("Expected a layer between 0 and 3.");
+	char *typeStr = toRawString(args[1]);
+	BgType type;
+	bool valid = true;
+	if (strcmp(typeStr, "text4bpp") == 0) type = BgType_Text4bpp;
+	else if (strcmp(typeStr, "text8bpp") == 0) type = BgType_Text8bpp;
+	else if (strcmp(typeStr, "affine") == 0) type = BgType_Rotation;
+	else if (strcmp(typeStr, "extended") == 0) type = BgType_ExRotation;
+	else if (strcmp(typeStr, "bitmap8") == 0) type = BgType_Bmp8;
+	else if (strcmp(typeStr, "bitmap16") == 0) type = BgType_Bmp16;
+	else valid = false;
+	free(typeStr);
+	if (!valid) return TypeError("Expected a background type of 'text4bpp', 'text8bpp', 'affine', 'extended', 'bitmap8', or 'bitmap16'.");
+	bool bitmap = isBitmapBackground(type);
+	if (!bitmap) REQUIRE(6);
+	if (type != BgType_Text4bpp && type != BgType_Text8bpp && layer < 2) return RangeError("Only text backgrounds can be on layers 0 and 1.");
+	int width = jerry_value_as_int32(args[2]), height = jerry_value_as_int32(args[3]);
+	BgSize size;
+	if (!backgroundSize(type, width, height, &size)) return RangeError("Unsupported size for this background type.");
+	u32 mapBase = jerry_value_as_uint32(args[4]), tileBase = bitmap ? 0 : jerry_value_as_uint32(args[5]);
+	if (mapBase > 31) return RangeError(bitmap ? "Expected a bitmap base between 0 and 31." : "Expected a map base between 0 and 31.");
+	if (tileBase > 15) return RangeError("Expected a tile base between 0 and 15.");
+	// bitmap backgrounds are double buffered when given a second base
+	bool doubleBuffered = bitmap && argCount > 5 && !jerry_value_is_undefined(args[5]);
+	u32 backBase = doubleBuffered ? jerry_value_as_uint32(args[5]) : mapBase;
+	if (bitmap) {
+		u32 byteSize = width * height * (type == BgType_Bmp16 ? 2 : 1), memorySize = engine->main ? 0x80000 : 0x20000;
+		if (mapBase * 0x4000 + byteSize > memorySize || backBase * 0x4000 + byteSize > memorySize) {
+			return RangeError("Bitmap doesn't fit in background memory at this base.");
+		}
+		if (doubleBuffered && (backBase > mapBase ? backBase - mapBase : mapBase - backBase) * 0x4000 < byteSize) {
+			return RangeError("Bitmap pages overlap.");
+		}
+	}
+
+	jerry_value_t bitmapObj = JS_UNDEFINED;
+	if (bitmap) {
+		bitmapObj = bitmapCreate(width, height, type == BgType_Bmp16 ? 16 : 8);
+		if (jerry_value_is_error(bitmapObj)) return bitmapObj;
+	}
+	int id = engine->main ? bgInit(layer, type, size, mapBase, tileBase) : bgInitSub(layer, type, size, mapBase, tileBase);
+	if (backgroundSlots[id] != NULL) {
+		NativeBackground *previous = backgroundSlots[id];
+		previous->removed = true;
+		if (previous->swapPending) {
+			jerry_release_value(jerry_resolve_or_reject_promise(previous->presentPromise, JS_UNDEFINED, true));
+			jerry_release_value(previous->presentPromise);
+		}
+		previous->swapPending = false;
+	}
+	jerry_release_value(backgroundObjects[id]);
+	jerry_value_t backgroundObj = jerry_create_object();
+	NativeBackground *bg = backgroundSlots[id] = setNative(backgroundObj, new NativeBackground{
+		.id = (u8) id,
+		.main = engine->main,
+		.removed = false,
+		.hidden = false,
+		.type = type,
+		.width = (u16) width,
+		.height = (u16) height,
+		.x = 0,
+		.y = 0,
+		.bitmap = NULL,
+		.doubleBuffered = doubleBuffered,
+		.pageBases = {(u8) mapBase, (u8) backBase},
+		.frontPage = 0,
+		.swapPending = false,
+		.presentPromise = JS_UNDEFINED
+	});
+	if (bitmap) {
+		bg->bitmap = getNative<NativeBitmap>(bitmapObj);
+		bg->bitmap->background = id;
+		setInternal(backgroundObj, "bitmap", bitmapObj);
+		jerry_release_value(bitmapObj);
+	}
+	setPrototype(backgroundObj, ref_Background.prototype);
+	backgroundObjects[id] = jerry_acquire_value(backgroundObj);
+	return backgroundObj;
+}
+
+u8 Background_get_layer(NativeBackground *bg) {
+	return bg->id & 3;
+}
+JS_value Background_get_type(NativeBackground *bg) {
+	return String(
+		bg->type == BgType_Text4bpp ? "text4bpp" :
+		bg->type == BgType_Text8bpp ? "text8bpp" :
+		bg->type == BgType_Rotation ? "affine" :
+		bg->type == BgType_ExRotation ? "extended" :
+		bg->type == BgType_Bmp8 ? "bitmap8" :
+		"bitmap16"
+	);
+}
+
+void Background_set_x(NativeBackground *bg, int x) {
+	bg->x = x;
+	bgSetScroll(bg->id, bg->x, bg->y);
+}
+void Background_set_y(NativeBackground *bg, int y) {
+	bg->y = y;
+	bgSetScroll(bg->id, bg->x, bg->y);
+}
+void Background_setScroll(NativeBackground *bg, int x, int y) {
+	bg->x = x;
+	bg->y = y;
+	bgSetScroll(bg->id, bg->x, bg->y);
+}
+
+int Background_get_priority(NativeBackground *bg) {
+	return bgGetPriority(bg->id);
+}
+void Background_set_priority(NativeBackground *bg, int priority) {
+	bgSetPriority(bg->id, BOUND(priority, 0, 3));
+}
+void Background_set_hidden(NativeBackground *bg, bool hidden) {
+	bg->hidden = hidden;
+	if (hidden) bgHide(bg->id);
+	else bgShow(bg->id);
+}
+
+FUNCTION(Background_get_bitmap) {
+	jerry_value_t bitmapObj = getInternal(thisValue, "bitmap");
+	if (!jerry_value_is_undefined(bitmapObj)) return bitmapObj;
+	return JS_NULL;
+}
+
+JS_value Background_rotateScale(NativeBackground *bg, int angle, double sx, double sy) {
+	if (isTextBackground(bg)) return TypeError("Text backgrounds can't be rotated or scaled.");
+	bgSetRotateScale(bg->id, degreesToAngle(angle), floatToFixed(sx, 8), floatToFixed(sy, 8));
+	return JS_UNDEFINED;
+}
+JS_value Background_setCenter(NativeBackground *bg, int x, int y) {
+	if (isTextBackground(bg)) return TypeError("Text backgrounds can't be rotated or scaled.");
+	bgSetCenter(bg->id, x, y);
+	return JS_UNDEFINED;
+}
+
+JS_value Background_getTile(NativeBackground *bg, int x, int y) {
+	if (isBitmapBackground(bg->type)) return TypeError(NO_TILES);
+	return jerry_create_number(readMapEntry(bg, mapIndex(bg, x, y)));
+}
+JS_value Background_setTile(NativeBackground *bg, int x, int y, int entry) {
+	if (isBitmapBackground(bg->type)) return TypeError(NO_TILES);
+	writeMapEntry(bg, mapIndex(bg, x, y), entry);
+	return JS_UNDEFINED;
+}
+
+FUNCTION(Background_setTiles) {
+	NATIVE_THIS(NativeBackground, bg);
+	if (bg->removed) return TypeError(WAS_REMOVED);
+	if (isBitmapBackground(bg->type)) return TypeError(NO_TILES);
+	REQUIRE(5); EXPECT(jerry_value_is_typedarray(args[4]), TypedArray);
+	int x = jerry_value_as_int32(args[0]), y = jerry_value_as_int32(args[1]);
+	u32 width = jerry_value_as_uint32(args[2]), height = jerry_value_as_uint32(args[3]);
+	jerry_typedarray_type_t type = jerry_get_typedarray_type(args[4]);
+	if (type != JERRY_TYPEDARRAY_UINT8 && type != JERRY_TYPEDARRAY_UINT16) return TypeError("Expected a Uint8Array or Uint16Array of map entries.");
+	// positions wrap around the map, so an area larger than it would only write over itself
+	if (width > bg->width / 8u || height > bg->height / 8u) return RangeError("Area is larger than the map.");
+	if (jerry_get_typedarray_length(args[4]) < width * height) return RangeError("Not enough map entries for the given area.");
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(args[4], &byteOffset, &byteLength);
+	u8 *data = jerry_get_arraybuffer_pointer(arrayBuffer) + byteOffset;
+	jerry_release_value(arrayBuffer);
+	for (u32 row = 0; row < height; row++) {
+		for (u32 col = 0; col < width; col++) {
+			u32 i = col + row * width;
+			u16 entry = type == JERRY_TYPEDARRAY_UINT8 ? data[i] : ((u16 *) data)[i];
+			writeMapEntry(bg, mapIndex(bg, x + col, y + row), entry);
+		}
+	}
+	return JS_UNDEFINED;
+}
+
+FUNCTION(Background_uploadTiles) {
+	NATIVE_THIS(NativeBackground, bg);
+	if (bg->removed) return TypeError(WAS_REMOVED);
+	if (isBitmapBackground(bg->type)) return TypeError(NO_TILES);
+	REQUIRE(1);
+	u32 offset = argCount > 1 ? jerry_value_as_uint32(args[1]) : 0;
+	bool compressed = argCount > 2 && jerry_value_to_boolean(args[2]);
+	return uploadToVram(args[0], offset, compressed, (u8 *) bgGetGfxPtr(bg->id), tilesByteSize(bg));
+}
+FUNCTION(Background_uploadMap) {
+	NATIVE_THIS(NativeBackground, bg);
+	if (bg->removed) return TypeError(WAS_REMOVED);
+	if (isBitmapBackground(bg->type)) return TypeError(NO_TILES);
+	REQUIRE(1);
+	u32 offset = argCount > 1 ? jerry_value_as_uint32(args[1]) : 0;
+	bool compressed = argCount > 2 && jerry_value_to_boolean(args[2]);
+	return uploadToVram(args[0], offset, compressed, (u8 *) bgGetMapPtr(bg->id), mapByteSize(bg));
+}
+
+void exposeBackgroundAPI(jerry_value_t global) {
+	for (jerry_value_t &backgroundObj : backgroundObjects) backgroundObj = JS_UNDEFINED;
+	JS_class Background = createClass(global, "Background", IllegalConstructor);
+	defGetterSetter(Background.prototype, "x", nativeGetter<&NativeBackground::x>, bindMethod<Background_set_x>);
+	defGetterSetter(Background.prototype, "y", nativeGetter<&NativeBackground::y>, bindMethod<Background_set_y>);
+	setMethod(Background.prototype, "setScroll", bindMethod<Background_setScroll>);
+	defGetterSetter(Background.prototype, "priority", bindMethod<Background_get_priority>, bindMethod<Background_set_priority>);
+	defGetterSetter(Background.prototype, "hidden", nativeGetter<&NativeBackground::hidden>, bindMethod<Background_set_hidden>);
+	setMethod(Background.prototype, "rotateScale", bindMethod<Background_rotateScale>);
+	setMethod(Background.prototype, "setCenter", bindMethod<Background_setCenter>);
+	setMethod(Background.prototype, "getTile", bindMethod<Background_getTile>);
+	setMethod(Background.prototype, "setTile", bindMethod<Background_setTile>);
+	setMethod(Background.prototype, "setTiles", Background_setTiles);
+	setMethod(Background.prototype, "uploadTiles", Background_uploadTiles);
+	setMethod(Background.prototype, "uploadMap", Background_uploadMap);
+	defGetter(Background.prototype, "layer", bindMethod<Background_get_layer>);
+	defGetter(Background.prototype, "type", bindMethod<Background_get_type>);
+	defNativeGetter<&NativeBackground::width>(Background.prototype, "width");
+	defNativeGetter<&NativeBackground::height>(Background.prototype, "height");
+	defNativeGetter<&NativeBackground::main>(Background.prototype, "main");
+	defNativeGetter<&NativeBackground::doubleBuffered>(Background.prototype, "doubleBuffered");
+	defGetter(Background.prototype, "bitmap", Background_get_bitmap);
+	ref_Background = Background;
+
+	jerry_value_t BackgroundEngine = jerry_create_object();
+	setMethod(BackgroundEngine, "init", BackgroundEngine_init);
+	jerry_value_t main = createObject(Background.constructor, "main");
+	setNative(main, new NativeBackgroundEngine{.main = true});
+	jerry_value_t mainPaletteArrayBuffer = jerry_create_arraybuffer_external(256 * sizeof(u16), (u8*) BG_PALETTE, [](void * _){});
+	jerry_value_t mainPaletteTypedArray = jerry_create_typedarray_for_arraybuffer_sz(JERRY_TYPEDARRAY_UINT16, mainPaletteArrayBuffer, 0, 256);
+	defReadonly(main, "palette", mainPaletteTypedArray);
+	jerry_release_value(mainPaletteTypedArray);
+	jerry_release_value(mainPaletteArrayBuffer);
+	setPrototype(main, BackgroundEngine);
+	jerry_release_value(main);
+	jerry_value_t sub = createObject(Background.constructor, "sub");
+	setNative(sub, new NativeBackgroundEngine{.main = false});
+	jerry_value_t subPaletteArrayBuffer = jerry_create_arraybuffer_external(256 * sizeof(u16), (u8*) BG_PALETTE_SUB, [](void * _){});
+	jerry_value_t subPaletteTypedArray = jerry_create_typedarray_for_arraybuffer_sz(JERRY_TYPEDARRAY_UINT16, subPaletteArrayBuffer, 0, 256);
+	defReadonly(sub, "palette", subPaletteTypedArray);
+	jerry_release_value(subPaletteTypedArray);
+	jerry_release_value(subPaletteArrayBuffer);
+	setPrototype(sub, BackgroundEngine);
+	jerry_release_value(sub);
+	jerry_release_value(BackgroundEngine);
+}
+
+void releaseBackgroundReferences() {
+	for (jerry_value_t backgroundObj : backgroundObjects) jerry_release_value(backgroundObj);
+	releaseClass(ref_Background);
+}
\ No newline at end of file
@@ -0,0 +1,491 @@
+#include "bitmap.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "background.hpp"
+#include "util/helpers.hpp"
+
+
+
+JS_class ref_Bitmap;
+
+// keeps shapes far outside the bitmap from taking forever to draw
+const int COORD_LIMIT = 0x4000;
+
+NativeBitmap::~NativeBitmap() {
+	if (background != -1) {
+		NativeBackground *bg = backgroundSlots[background];
+		if (bg != NULL && bg->bitmap == this) bg->bitmap = NULL;
+	}
+	free(pixels);
+}
+
+NativeBitmap *newBitmap(u8 *pixels, u16 width, u16 height, u8 bpp) {
+	return new NativeBitmap{
+		.pixels = pixels,
+		.width = width,
+		.height = height,
+		.bpp = bpp,
+		.background = -1,
+		.autoFlush = true,
+		.dirty = {0, 0, width, height},
+		.backStale = {0, 0, 0, 0},
+		.frontStale = {0, 0, 0, 0}
+	};
+}
+
+jerry_value_t bitmapCreate(u16 width, u16 height, u8 bpp) {
+	u8 *pixels = (u8 *) calloc(width * height, bpp / 8);
+	if (pixels == NULL) return Error("Not enough memory for the bitmap.");
+	jerry_value_t bitmapObj = jerry_create_object();
+	setNative(bitmapObj, newBitmap(pixels, width, height, bpp));
+	setPrototype(bitmapObj, ref_Bitmap.prototype);
+	return bitmapObj;
+}
+
+// Grows an area to cover another.
+void rectUnion(BitmapRect &rect, const BitmapRect &other) {
+	if (other.left >= other.right) return;
+	if (rect.left >= rect.right) {
+		rect = other;
+		return;
+	}
+	if (other.left < rect.left) rect.left = other.left;
+	if (other.top < rect.top) rect.top = other.top;
+	if (other.right > rect.right) rect.right = other.right;
+	if (other.bottom > rect.bottom) rect.bottom = other.bottom;
+}
+
+void bitmapFlush(NativeBitmap *bitmap) {
+	NativeBackground *bg = bitmap->background == -1 ? NULL : backgroundSlots[bitmap->background];
+	if (bg != NULL && bg->bitmap == bitmap) {
+		// the back page can be out of date even with nothing newly drawn, when the last frame went to the other page
+		BitmapRect area = bitmap->dirty;
+		if (bg->doubleBuffered) {
+			rectUnion(area, bitmap->backStale);
+			rectUnion(bitmap->frontStale, bitmap->dirty);
+			bitmap->backStale = {0, 0, 0, 0};
+		}
+		if (area.left >= area.right) return;
+		u32 rowSize = bitmap->width * bitmap->bpp / 8;
+		// 8bpp rows are copied in whole halfwords
+		u32 left = (area.left * bitmap->bpp / 8) & ~1;
+		u32 right = (area.right * bitmap->bpp / 8 + 1) & ~1;
+		u8 *vram = (u8 *) backgroundBitmapTarget(bg);
+		u32 top = area.top * rowSize, bottom = area.bottom * rowSize;
+		if (left == 0 && right == rowSize) copyToVram(bitmap->pixels + top, vram + top, bottom - top);
+		else for (u32 row = top; row < bottom; row += rowSize) {
+			copyToVram(bitmap->pixels + row + left, vram + row + left, right - left);
+		}
+	}
+	bitmap->dirty = {0, 0, 0, 0};
+}
+
+// The new back page is missing what was flushed to the other page since the last swap.
+void bitmapPagesSwapped(NativeBitmap *bitmap) {
+	rectUnion(bitmap->backStale, bitmap->frontStale);
+	bitmap->frontStale = {0, 0, 0, 0};
+}
+
+void bitmapUpdate() {
+	for (NativeBackground *bg : backgroundSlots) {
+		if (bg == NULL || bg->bitmap == NULL || !bg->bitmap->autoFlush) continue;
+		if (bg->doubleBuffered && bg->bitmap->dirty.left < bg->bitmap->dirty.right) {
+			bitmapFlush(bg->bitmap);
+			backgroundPresent(bg);
+		}
+		else bitmapFlush(bg->bitmap);
+	}
+}
+
+/* Clips a rectangle to the bitmap. Returns false if none of it is left.
+ * Done in 64 bits, since positions from scripts can be anywhere in the int range.
+ */
+bool clipRect(NativeBitmap *bitmap, int &x, int &y, int &width, int &height) {
+	s64 left = std::max<s64>(x, 0), top = std::max<s64>(y, 0);
+	s64 right = std::min<s64>((s64) x + width, bitmap->width), bottom = std::min<s64>((s64) y + height, bitmap->height);
+	if (left >= right || top >= bottom) return false;
+	x = left;
+	y = top;
+	width = right - left;
+	height = bottom - top;
+	return true;
+}
+
+// Grows the dirty area to cover a rectangle.
+void markDirty(NativeBitmap *bitmap, int x, int y, int width, int height) {
+	if (!clipRect(bitmap, x, y, width, height)) return;
+	rectUnion(bitmap->dirty, {(u16) x, (u16) y, (u16) (x + width), (u16) (y + height)});
+}
+
+inline u16 readPixel(NativeBitmap *bitmap, int x, int y) {
+	u32 index = x + y * bitmap->width;
+	return bitmap->bpp == 16 ? ((u16 *) bitmap->pixels)[index] : bitmap->pixels[index];
+}
+inline void plotPixel(NativeBitmap *bitmap, int x, int y, u16 color) {
+	if (x < 0 || y < 0 || x >= bitmap->width || y >= bitmap->height) return;
+	u32 index = x + y * bitmap->width;
+	if (bitmap->bpp == 16) ((u16 *) bitmap->pixels)[index] = color;
+	else bitmap->pixels[index] = color;
+}
+// Fills part of a row, which must already be clipped.
+inline void fillSpan(NativeBitmap *bitmap, int x, int y, int width, u16 color) {
+	u32 index = x + y * bitmap->width;
+	if (bitmap->bpp == 16) std::fill_n((u16 *) bitmap->pixels + index, width, color);
+	else memset(bitmap->pixels + index, color, width);
+}
+void fillRect(NativeBitmap *bitmap, int x, int y, int width, int height, u16 color) {
+	if (!clipRect(bitmap, x, y, width, height)) return;
+	for (int row = y; row < y + height; row++) fillSpan(bitmap, x, row, width, color);
+	markDirty(bitmap, x, y, width, height);
+}
+
+FUNCTION(BitmapConstructor) {
+	CONSTRUCTOR(Bitmap); REQUIRE(2);
+	u32 width = jerry_value_as_uint32(args[0]), height = jerry_value_as_uint32(args[1]);
+	u32 bpp = argCount > 2 ? jerry_value_as_uint32(args[2]) : 16;
+	if (width == 0 || height == 0 || width > 1024 || height > 1024) return RangeError("Expected a width and height between 1 and 1024.");
+	if (bpp != 8 && bpp != 16) return TypeError("Expected a bits-per-pixel value of either 8 or 16.");
+	u8 *pixels = (u8 *) calloc(width * height, bpp / 8);
+	if (pixels == NULL) return Error("Not enough memory for the bitmap.");
+	setNative(thisValue, newBitmap(pixels, width, height, bpp));
+	return JS_UNDEFINED;
+}
+
+u16 Bitmap_getPixel(NativeBitmap *bitmap, int x, int y) {
+	if (x < 0 || y < 0 || x >= bitmap->width || y >= bitmap->height) return 0;
+	return readPixel(bitmap, x, y);
+}
+void Bitmap_setPixel(NativeBitmap *bitmap, int x, int y, int color) {
+	plotPixel(bitmap, x, y, color);
+	markDirty(bitmap, x, y, 1, 1);
+}
+
+void Bitmap_clear(NativeBitmap *bitmap, std::optional<int> color) {
+	fillRect(bitmap, 0, 0, bitmap->width, bitmap->height, color.value_or(0));
+}
+void Bitmap_fillRect(NativeBitmap *bitmap, int x, int y, int width, int height, int color) {
+	fillRect(bitmap, x, y, width, height, color);
+}
+void Bitmap_strokeRect(NativeBitmap *bitmap, int x, int y, int width, int height, int color) {
+	if (width <= 0 || height <= 0 || x >= bitmap->width || y >= bitmap->height) return;
+	// the far edges can be past the int range, in which case they're off the bitmap anyway
+	s64 right = (s64) x + width - 1, bottom = (s64) y + height - 1;
+	fillRect(bitmap, x, y, width, 1, color);
+	if (bottom < bitmap->height) fillRect(bitmap, x, bottom, width, 1, color);
+	fillRect(bitmap, x, y + 1, 1, height - 2, color);
+	if (right < bitmap->width) fillRect(bitmap, right, y + 1, 1, height - 2, color);
+}
+
+void Bitmap_drawLine(NativeBitmap *bitmap, int x0, int y0, int x1, int y1, int color) {
+	x0 = BOUND(x0, -COORD_LIMIT, COORD_LIMIT);
+	y0 = BOUND(y0, -COORD_LIMIT, COORD_LIMIT);
+	x1 = BOUND(x1, -COORD_LIMIT, COORD_LIMIT);
+	y1 = BOUND(y1, -COORD_LIMIT, COORD_LIMIT);
+	markDirty(bitmap, std::min(x0, x1), std::min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1);
+	int dx = abs(x1 - x0), dy = -abs(y1 - y0);
+	int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+	int error = dx + dy;
+	while (true) {
+		plotPixel(bitmap, x0, y0, color);
+		if (x0 == x1 && y0 == y1) break;
+		int error2 = error * 2;
+		if (error2 >= dy) {
+			error += dy;
+			x0 += sx;
+		}
+		if (error2 <= dx) {
+			error += dx;
+			y0 += sy;
+		}
+	}
+}
+
+void Bitmap_fillCircle(NativeBitmap *bitmap, int cx, int cy, int radius, int color) {
+	if (radius < 0) return;
+	radius = std::min(radius, COORD_LIMIT);
+	cx = BOUND(cx, -COORD_LIMIT * 2, COORD_LIMIT * 2);
+	cy = BOUND(cy, -COORD_LIMIT * 2, COORD_LIMIT * 2);
+	for (int y = 0, x = radius; y <= radius; y++) {
+		while (x * x + y * y > radius * radius + radius) x--;
+		fillRect(bitmap, cx - x, cy + y, x * 2 + 1, 1, color);
+		if (y != 0) fillRect(bitmap, cx - x, cy - y, x * 2 + 1, 1, color);
+	}
+}
+void Bitmap_strokeCircle(NativeBitmap *bitmap, int cx, int cy, int radius, int color) {
+	if (radius < 0) return;
+	radius = std::min(radius, COORD_LIMIT);
+	cx = BOUND(cx, -COORD_LIMIT * 2, COORD_LIMIT * 2);
+	cy = BOUND(cy, -COORD_LIMIT * 2, COORD_LIMIT * 2);
+	markDirty(bitmap, cx - radius, cy - radius, radius * 2 + 1, radius * 2 + 1);
+	int x = radius, y = 0, error = 1 - radius;
+	while (x >= y) {
+		plotPixel(bitmap, cx + x, cy + y, color);
+		plotPixel(bitmap, cx - x, cy + y, color);
+		plotPixel(bitmap, cx + x, cy - y, color);
+		plotPixel(bitmap, cx - x, cy - y, color);
+		plotPixel(bitmap, cx + y, cy + x, color);
+		plotPixel(bitmap, cx - y, cy + x, color);
+		plotPixel(bitmap, cx + y, cy - x, color);
+		plotPixel(bitmap, cx - y, cy - x, color);
+		y++;
+		if (error < 0) error += y * 2 + 1;
+		else {
+			x--;
+			error += (y - x) * 2 + 1;
+		}
+	}
+}
+
+// Scanline fill: each span of matching pixels is filled whole, then seeds the runs above and below it.
+void Bitmap_floodFill(NativeBitmap *bitmap, int x, int y, int color) {
+	if (x < 0 || y < 0 || x >= bitmap->width || y >= bitmap->height) return;
+	u16 target = readPixel(bitmap, x, y);
+	if (bitmap->bpp == 8) color &= 0xFF;
+	if (target == (u16) color) return;
+	std::vector<u32> seeds = {(u32) (x | y << 16)};
+	while (!seeds.empty()) {
+		int sx = seeds.back() & 0xFFFF, sy = seeds.back() >> 16;
+		seeds.pop_back();
+		if (readPixel(bitmap, sx, sy) != target) continue;
+		int left = sx, right = sx;
+		while (left > 0 && readPixel(bitmap, left - 1, sy) == target) left--;
+		while (right < bitmap->width - 1 && readPixel(bitmap, right + 1, sy) == target) right++;
+		fillSpan(bitmap, left, sy, right - left + 1, color);
+		markDirty(bitmap, left, sy, right - left + 1, 1);
+		for (int ny = sy - 1; ny <= sy + 1; ny += 2) {
+			if (ny < 0 || ny >= bitmap->height) continue;
+			bool inRun = false;
+			for (int nx = left; nx <= right; nx++) {
+				bool matches = readPixel(bitmap, nx, ny) == target;
+				if (matches && !inRun) seeds.push_back(nx | ny << 16);
+				inRun = matches;
+			}
+		}
+	}
+}
+
+/* Clips a copy of a source area to a destination position, adjusting both.
+ * Returns false if nothing is left to copy. Done in 64 bits, like clipRect.
+ */
+bool clipBlit(NativeBitmap *dest, NativeBitmap *source, int &x, int &y, int &sx, int &sy, int &width, int &height) {
+	s64 dx = x, dy = y, srcX = sx, srcY = sy, w = width, h = height;
+	if (srcX < 0) {
+		dx -= srcX;
+		w += srcX;
+		srcX = 0;
+	}
+	if (srcY < 0) {
+		dy -= srcY;
+		h += srcY;
+		srcY = 0;
+	}
+	if (dx < 0) {
+		srcX -= dx;
+		w += dx;
+		dx = 0;
+	}
+	if (dy < 0) {
+		srcY -= dy;
+		h += dy;
+		dy = 0;
+	}
+	w = std::min({w, source->width - srcX, dest->width - dx});
+	h = std::min({h, source->height - srcY, dest->height - dy});
+	if (w <= 0 || h <= 0) return false;
+	x = dx;
+	y = dy;
+	sx = srcX;
+	sy = srcY;
+	width = w;
+	height = h;
+	return true;
+}
+
+JS_value Bitmap_blit(
+	NativeBitmap *bitmap, NativeArg<NativeBitmap> source, int x, int y, std::optional<int> colorKey,
+	std::optional<int> sx, std::optional<int> sy, std::optional<int> width, std::optional<int> height
+) {
+	if (source->bpp != bitmap->bpp) return TypeError("Expected a Bitmap with the same color format.");
+	int srcX = sx.value_or(0), srcY = sy.value_or(0);
+	int w = width.value_or(source->width - srcX), h = height.value_or(source->height - srcY);
+	if (!clipBlit(bitmap, source.native, x, y, srcX, srcY, w, h)) return JS_UNDEFINED;
+	u8 bytes = bitmap->bpp / 8;
+	// rows are copied bottom up when blitting down within the same bitmap, so they aren't overwritten before being read
+	bool reverse = source.native == bitmap && y > srcY;
+	for (int i = 0; i < h; i++) {
+		int row = reverse ? h - 1 - i : i;
+		u8 *src = source->pixels + ((srcY + row) * source->width + srcX) * bytes;
+		u8 *dst = bitmap->pixels + ((y + row) * bitmap->width + x) * bytes;
+		if (!colorKey.has_value()) memmove(dst, src, w * bytes);
+		else if (bytes == 2) {
+			u16 key = colorKey.value();
+			for (int col = 0; col < w; col++) if (((u16 *) src)[col] != key) ((u16 *) dst)[col] = ((u16 *) src)[col];
+		}
+		else {
+			u8 key = colorKey.value();
+			for (int col = 0; col < w; col++) if (src[col] != key) dst[col] = src[col];
+		}
+	}
+	markDirty(bitmap, x, y, w, h);
+	return JS_UNDEFINED;
+}
+
+// Draws an 8bpp bitmap onto a 16bpp bitmap through a palette, leaving out one index if colorKey is given.
+FUNCTION(Bitmap_blitPalette) {
+	NATIVE_THIS(NativeBitmap, bitmap);
+	REQUIRE(4);
+	NativeBitmap *source = getNative<NativeBitmap>(args[0]);
+	EXPECT(source != NULL, Bitmap);
+	if (source->bpp != 8 || bitmap->bpp != 16) return TypeError("Expected to draw an 8bpp Bitmap onto a 16bpp Bitmap.");
+	EXPECT(jerry_value_is_typedarray(args[1]) && jerry_get_typedarray_type(args[1]) == JERRY_TYPEDARRAY_UINT16, Uint16Array);
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(args[1], &byteOffset, &byteLength);
+	u16 *palette = (u16 *) (jerry_get_arraybuffer_pointer(arrayBuffer) + byteOffset);
+	jerry_release_value(arrayBuffer);
+	u32 paletteLength = byteLength / 2;
+	int x = jerry_value_as_int32(args[2]), y = jerry_value_as_int32(args[3]);
+	bool keyed = argCount > 4 && !jerry_value_is_undefined(args[4]);
+	u8 key = keyed ? jerry_value_as_uint32(args[4]) : 0;
+	int sx = argCount > 5 ? jerry_value_as_int32(args[5]) : 0;
+	int sy = argCount > 6 ? jerry_value_as_int32(args[6]) : 0;
+	int width = argCount > 7 ? jerry_value_as_int32(args[7]) : source->width - sx;
+	int height = argCount > 8 ? jerry_value_as_int32(args[8]) : source->height - sy;
+	if (!clipBlit(bitmap, source, x, y, sx, sy, width, height)) return JS_UNDEFINED;
+	for (int row = 0; row < height; row++) {
+		u8 *src = source->pixels + (sy + row) * source->width + sx;
+		u16 *dst = (u16 *) bitmap->pixels + (y + row) * bitmap->width + x;
+		for (int col = 0; col < width; col++) {
+			u8 index = src[col];
+			if (keyed && index == key) continue;
+			// palette colors have no alpha bit, which bitmap backgrounds need to show a pixel
+			dst[col] = (index < paletteLength ? palette[index] : 0) | BIT(15);
+		}
+	}
+	markDirty(bitmap, x, y, width, height);
+	return JS_UNDEFINED;
+}
+
+// Gets the pixels of a typed array matching the color format of a bitmap, or NULL if it doesn't match.
+u8 *imageDataPixels(NativeBitmap *bitmap, jerry_value_t data, u32 *length) {
+	if (!jerry_value_is_typedarray(data)) return NULL;
+	jerry_typedarray_type_t type = jerry_get_typedarray_type(data);
+	if (bitmap->bpp == 16 ? type != JERRY_TYPEDARRAY_UINT16 : type != JERRY_TYPEDARRAY_UINT8 && type != JERRY_TYPEDARRAY_UINT8CLAMPED) return NULL;
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(data, &byteOffset, &byteLength);
+	u8 *pixels = jerry_get_arraybuffer_pointer(arrayBuffer);
+	jerry_release_value(arrayBuffer);
+	*length = byteLength * 8 / bitmap->bpp;
+	return pixels == NULL ? NULL : pixels + byteOffset;
+}
+
+/* Copies rows of pixels between a bitmap and a buffer holding stride pixels per row.
+ * Full width areas with no gaps between rows are copied at once.
+ */
+void copyRows(NativeBitmap *bitmap, u8 *buffer, u32 stride, int x, int y, int width, int height, bool toBitmap) {
+	u8 bytes = bitmap->bpp / 8;
+	u8 *area = bitmap->pixels + (x + y * bitmap->width) * bytes;
+	if (width == bitmap->width && stride == bitmap->width) {
+		if (toBitmap) memcpy(area, buffer, width * height * bytes);
+		else memcpy(buffer, area, width * height * bytes);
+		return;
+	}
+	for (int row = 0; row < height; row++) {
+		u8 *bitmapRow = area + row * bitmap->width * bytes, *bufferRow = buffer + row * stride * bytes;
+		if (toBitmap) memcpy(bitmapRow, bufferRow, width * bytes);
+		else memcpy(bufferRow, bitmapRow, width * bytes);
+	}
+}
+
+FUNCTION(Bitmap_putImageData) {
+	NATIVE_THIS(NativeBitmap, bitmap);
+	REQUIRE(4);
+	u32 length;
+	u8 *data = imageDataPixels(bitmap, args[0], &length);
+	if (data == NULL) return TypeError(bitmap->bpp == 16 ? "Expected a Uint16Array for a 16bpp Bitmap." : "Expected a Uint8Array for an 8bpp Bitmap.");
+	int x = jerry_value_as_int32(args[1]), y = jerry_value_as_int32(args[2]);
+	int width = jerry_value_as_int32(args[3]);
+	u32 stride = argCount > 5 ? jerry_value_as_uint32(args[5]) : width;
+	if (width <= 0 || stride < (u32) width) return RangeError("Expected a positive width, no larger than stride.");
+	if (stride > length) return RangeError("Not enough pixels for the given area.");
+	int height = argCount > 4 && !jerry_value_is_undefined(args[4]) ? jerry_value_as_int32(args[4]) : length / stride;
+	if (height <= 0) return JS_UNDEFINED;
+	// in 64 bits so a large height and stride can't wrap around, which also keeps the offsets of rows within the data
+	if ((u64) (height - 1) * stride + width > length) return RangeError("Not enough pixels for the given area.");
+	int areaX = x, areaY = y, areaWidth = width, areaHeight = height;
+	if (!clipRect(bitmap, areaX, areaY, areaWidth, areaHeight)) return JS_UNDEFINED;
+	copyRows(bitmap, data + ((areaX - x) + (areaY - y) * stride) * (bitmap->bpp / 8), stride, areaX, areaY, areaWidth, areaHeight, true);
+	markDirty(bitmap, areaX, areaY, areaWidth, areaHeight);
+	return JS_UNDEFINED;
+}
+
+FUNCTION(Bitmap_getImageData) {
+	NATIVE_THIS(NativeBitmap, bitmap);
+	REQUIRE(4);
+	int x = jerry_value_as_int32(args[0]), y = jerry_value_as_int32(args[1]);
+	int width = jerry_value_as_int32(args[2]), height = jerry_value_as_int32(args[3]);
+	if (width <= 0 || height <= 0 || width > 1024 || height > 1024) return RangeError("Expected a width and height between 1 and 1024.");
+	jerry_value_t dataArr;
+	if (argCount > 4 && !jerry_value_is_undefined(args[4])) dataArr = jerry_acquire_value(args[4]);
+	else dataArr = jerry_create_typedarray(bitmap->bpp == 16 ? JERRY_TYPEDARRAY_UINT16 : JERRY_TYPEDARRAY_UINT8, width * height);
+	u32 length;
+	u8 *data = imageDataPixels(bitmap, dataArr, &length);
+	const char *error = NULL;
+	if (data == NULL) error = bitmap->bpp == 16 ? "Expected a Uint16Array for a 16bpp Bitmap." : "Expected a Uint8Array for an 8bpp Bitmap.";
+	else if (length < (u32) (width * height)) error = "Not enough room for the given area.";
+	if (error != NULL) {
+		jerry_release_value(dataArr);
+		return data == NULL ? TypeError(error) : RangeError(error);
+	}
+	// pixels outside the bitmap are read as 0
+	int areaX = x, areaY = y, areaWidth = width, areaHeight = height;
+	if (!clipRect(bitmap, areaX, areaY, areaWidth, areaHeight)) memset(data, 0, width * height * bitmap->bpp / 8);
+	else {
+		if (areaWidth != width || areaHeight != height) memset(data, 0, width * height * bitmap->bpp / 8);
+		copyRows(bitmap, data + ((areaX - x) + (areaY - y) * width) * (bitmap->bpp / 8), width, areaX, areaY, areaWidth, areaHeight, false);
+	}
+	return dataArr;
+}
+
+void Bitmap_flush(NativeBitmap *bitmap) {
+	bitmapFlush(bitmap);
+}
+
+// Flushes to the back page and swaps pages at the next vblank, returning a promise that resolves once they're swapped.
+JS_value Bitmap_present(NativeBitmap *bitmap) {
+	NativeBackground *bg = bitmap->background == -1 ? NULL : backgroundSlots[bitmap->background];
+	if (bg == NULL || bg->bitmap != bitmap || !bg->doubleBuffered) return TypeError("Bitmap isn't shown on a double buffered background.");
+	bitmapFlush(bitmap);
+	return jerry_acquire_value(backgroundPresent(bg));
+}
+
+void exposeBitmapAPI(jerry_value_t global) {
+	JS_class Bitmap = createClass(global, "Bitmap", BitmapConstructor);
+	defNativeGetter<&NativeBitmap::width>(Bitmap.prototype, "width");
+	defNativeGetter<&NativeBitmap::height>(Bitmap.prototype, "height");
+	defNativeGetter<&NativeBitmap::bpp>(Bitmap.prototype, "colorFormat");
+	defNativeGetterSetter<&NativeBitmap::autoFlush>(Bitmap.prototype, "autoFlush");
+	setMethod(Bitmap.prototype, "getPixel", bindMethod<Bitmap_getPixel>);
+	setMethod(Bitmap.prototype, "setPixel", bindMethod<Bitmap_setPixel>);
+	setMethod(Bitmap.prototype, "clear", bindMethod<Bitmap_clear>);
+	setMethod(Bitmap.prototype, "fillRect", bindMethod<Bitmap_fillRect>);
+	setMethod(Bitmap.prototype, "strokeRect", bindMethod<Bitmap_strokeRect>);
+	setMethod(Bitmap.prototype, "drawLine", bindMethod<Bitmap_drawLine>);
+	setMethod(Bitmap.prototype, "fillCircle", bindMethod<Bitmap_fillCircle>);
+	setMethod(Bitmap.prototype, "strokeCircle", bindMethod<Bitmap_strokeCircle>);
+	setMethod(Bitmap.prototype, "floodFill", bindMethod<Bitmap_floodFill>);
+	setMethod(Bitmap.prototype, "blit", bindMethod<Bitmap_blit>);
+	setMethod(Bitmap.prototype, "blitPalette", Bitmap_blitPalette);
+	setMethod(Bitmap.prototype, "putImageData", Bitmap_putImageData);
+	setMethod(Bitmap.prototype, "getImageData", Bitmap_getImageData);
+	setMethod(Bitmap.prototype, "flush", bindMethod<Bitmap_flush>);
+	setMethod(Bitmap.prototype, "present", bindMethod<Bitmap_present>);
+	ref_Bitmap = Bitmap;
+}
+
+void releaseBitmapReferences() {
+	releaseClass(ref_Bitmap);
+}
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "collision.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "event.hpp"
+#include "sprite.hpp"
+#include "util/helpers.hpp"
+
+
+
+JS_class ref_CollisionWorld;
+
+struct CollisionBody {
+	bool used;
+	NativeSprite *sprite; // NULL for boxes
+	jerry_value_t spriteObj; // owned, keeps sprite alive
+	s16 x;
+	s16 y;
+	u16 width;
+	u16 height;
+	u16 layer; // layers the body is in
+	u16 mask; // layers the body collides with
+	bool active; // has an area this update
+};
+
+/* Bodies are sorted into a uniform grid over the screen each update, and only bodies sharing a cell are tested.
+ * Bodies outside the screen are clamped into the edge cells.
+ */
+struct NativeCollisionWorld {
+	static constexpr const char *name = "CollisionWorld";
+	jerry_value_t object; // not owned
+	u16 cellSize;
+	u16 columns;
+	u16 rows;
+	std::vector<CollisionBody> bodies; // by ID, with unused entries reused
+	std::vector<u32> cellStart; // index into cellBodies of each cell's first body, which can outgrow a u16 with many large bodies
+	std::vector<u16> cellBodies;
+	std::vector<u16> pairs; // pairs of body IDs found by the last update
+	u16 listenerCount;
+
+	~NativeCollisionWorld();
+};
+
+std::vector<NativeCollisionWorld *> collisionWorlds;
+
+NativeCollisionWorld::~NativeCollisionWorld() {
+	for (CollisionBody &body : bodies) {
+		if (body.used && body.sprite != NULL) jerry_release_value(body.spriteObj);
+	}
+	collisionWorlds.erase(std::find(collisionWorlds.begin(), collisionWorlds.end(), this));
+	releaseNativeListeners(listenerCount);
+}
+
+void cellRange(NativeCollisionWorld *world, const CollisionBody &body, int &left, int &top, int &right, int &bottom) {
+	int lastColumn = world->columns - 1, lastRow = world->rows - 1;
+	left = BOUND(body.x / world->cellSize, 0, lastColumn);
+	top = BOUND(body.y / world->cellSize, 0, lastRow);
+	right = BOUND((body.x + body.width - 1) / world->cellSize, 0, lastColumn);
+	bottom = BOUND((body.y + body.height - 1) / world->cellSize, 0, lastRow);
+}
+
+void collisionWorldUpdate(NativeCollisionWorld *world) {
+	std::vector<CollisionBody> &bodies = world->bodies;
+	for (CollisionBody &body : bodies) {
+		if (!body.used) body.active = false;
+		else if (body.sprite == NULL) body.active = body.width > 0 && body.height > 0;
+		else body.active = spriteGetBounds(body.sprite, &body.x, &body.y, &body.width, &body.height);
+	}
+
+	// counting sort of bodies into cells
+	u32 cellCount = world->columns * world->rows;
+	world->cellStart.assign(cellCount + 1, 0);
+	int left, top, right, bottom;
+	for (CollisionBody &body : bodies) {
+		if (!body.active) continue;
+		cellRange(world, body, left, top, right, bottom);
+		for (int row = top; row <= bottom; row++) {
+			for (int column = left; column <= right; column++) world->cellStart[row * world->columns + column + 1]++;
+		}
+	}
+	for (u32 i = 0; i < cellCount; i++) world->cellStart[i + 1] += world->cellStart[i];
+	world->cellBodies.resize(world->cellStart[cellCount]);
+	std::vector<u32> fill(world->cellStart.begin(), world->cellStart.end() - 1);
+	for (u32 id = 0; id < bodies.size(); id++) {
+		if (!bodies[id].active) continue;
+		cellRange(world, bodies[id], left, top, right, bottom);
+		for (int row = top; row <= bottom; row++) {
+			for (int column = left; column <= right; column++) world->cellBodies[fill[row * world->columns + column]++] = id;
+		}
+	}
+
+	world->pairs.clear();
+	for (u32 cell = 0; cell < cellCount; cell++) {
+		for (u32 i = world->cellStart[cell]; i < world->cellStart[cell + 1]; i++) {
+			const CollisionBody &a = bodies[world->cellBodies[i]];
+			for (u32 j = i + 1; j < world->cellStart[cell + 1]; j++) {
+				const CollisionBody &b = bodies[world->cellBodies[j]];
+				if (!(a.layer & b.mask) || !(b.layer & a.mask)) continue;
+				if (a.x >= b.x + b.width || b.x >= a.x + a.width || a.y >= b.y + b.height || b.y >= a.y + a.height) continue;
+				// a pair sharing several cells is only reported from the one holding the top left corner of their overlap
+				CollisionBody corner = {.x = std::max(a.x, b.x), .y = std::max(a.y, b.y), .width = 1, .height = 1};
+				cellRange(world, corner, left, top, right, bottom);
+				if ((u32) (top * world->columns + left) != cell) continue;
+				world->pairs.push_back(world->cellBodies[i]);
+				world->pairs.push_back(world->cellBodies[j]);
+			}
+		}
+	}
+}
+
+u16 *collisionListenerCount(jerry_value_t target) {
+	NativeCollisionWorld *world = getNative<NativeCollisionWorld>(target);
+	return world == NULL ? NULL : &world->listenerCount;
+}
+
+void collisionUpdate() {
+	// worlds can be collected while events are created, so each is held onto while it's used
+	for (u32 w = 0; w < collisionWorlds.size(); w++) {
+		NativeCollisionWorld *world = collisionWorlds[w];
+		collisionWorldUpdate(world);
+		if (world->pairs.empty() || !hasEventListeners(world->object, "collide")) continue;
+		jerry_value_t worldObj = jerry_acquire_value(world->object);
+		for (u32 i = 0; i < world->pairs.size(); i += 2) {
+			jerry_value_t collideEvent = createEvent("collide", false);
+			defReadonly(collideEvent, "a", (double) world->pairs[i]);
+			defReadonly(collideEvent, "b", (double) world->pairs[i + 1]);
+			queueEvent(worldObj, collideEvent);
+			jerry_release_value(collideEvent);
+		}
+		jerry_release_value(worldObj);
+	}
+}
+
+// Returns the ID of a new body, reusing a removed one's.
+u16 addBody(NativeCollisionWorld *world, const CollisionBody &body) {
+	for (u32 id = 0; id < world->bodies.size(); id++) {
+		if (!world->bodies[id].used) {
+			world->bodies[id] = body;
+			return id;
+		}
+	}
+	world->bodies.push_back(body);
+	return world->bodies.size() - 1;
+}
+
+CollisionBody *getBody(NativeCollisionWorld *world, int id) {
+	if (id < 0 || (u32) id >= world->bodies.size() || !world->bodies[id].used) return NULL;
+	return &world->bodies[id];
+}
+
+
+
+FUNCTION(CollisionWorldConstructor) {
+	CONSTRUCTOR(CollisionWorld);
+	int cellSize = argCount > 0 && !jerry_value_is_undefined(args[0]) ? jerry_value_as_int32(args[0]) : 32;
+	if (cellSize < 8 || cellSize > 256) return RangeError("Cell size should be between 8 and 256.");
+	jerry_value_t eventListenersObj = jerry_create_object();
+	setInternal(thisValue, "eventListeners", eventListenersObj);
+	jerry_release_value(eventListenersObj);
+	collisionWorlds.push_back(setNative(thisValue, new NativeCollisionWorld{
+		.object = thisValue,
+		.cellSize = (u16) cellSize,
+		.columns = (u16) ((SCREEN_WIDTH + cellSize - 1) / cellSize),
+		.rows = (u16) ((SCREEN_HEIGHT + cellSize - 1) / cellSize),
+		.bodies = {},
+		.cellStart = {},
+		.cellBodies = {},
+		.pairs = {},
+		.listenerCount = 0
+	}));
+	return JS_UNDEFINED;
+}
+
+JS_value CollisionWorld_addSprite(NativeCollisionWorld *world, NativeArg<NativeSprite> sprite, std::optional<int> layer, std::optional<int> mask) {
+	if (world->bodies.size() >= 0xFFFF) return Error("Out of collision body slots.");
+	return jerry_create_number(addBody(world, {
+		.used = true,
+		.sprite = sprite.native,
+		.spriteObj = jerry_acquire_value(sprite.value),
+		.x = 0, .y = 0, .width = 0, .height = 0,
+		.layer = (u16) layer.value_or(1),
+		.mask = (u16) mask.value_or(0xFFFF),
+		.active = false
+	}));
+}
+
+JS_value CollisionWorld_addBox(NativeCollisionWorld *world, int x, int y, int width, int height, std::optional<int> layer, std::optional<int> mask) {
+	if (world->bodies.size() >= 0xFFFF) return Error("Out of collision body slots.");
+	return jerry_create_number(addBody(world, {
+		.used = true,
+		.sprite = NULL,
+		.spriteObj = JS_UNDEFINED,
+		.x = (s16) x, .y = (s16) y,
+		.width = (u16) (BOUND(width, 0, 0xFFFF)), .height = (u16) (BOUND(height, 0, 0xFFFF)),
+		.layer = (u16) layer.value_or(1),
+		.mask = (u16) mask.value_or(0xFFFF),
+		.active = false
+	}));
+}
+
+JS_value CollisionWorld_setBox(NativeCollisionWorld *world, int id, int x, int y, int width, int height) {
+	CollisionBody *body = getBody(world, id);
+	if (body == NULL) return RangeError("Body ID is not in use.");
+	if (body->sprite != NULL) return TypeError("Sprite bodies follow their sprite.");
+	body->x = x;
+	body->y = y;
+	body->width = BOUND(width, 0, 0xFFFF);
+	body->height = BOUND(height, 0, 0xFFFF);
+	return JS_UNDEFINED;
+}
+
+JS_value CollisionWorld_setLayers(NativeCollisionWorld *world, int id, int layer, int mask) {
+	CollisionBody *body = getBody(world, id);
+	if (body == NULL) return RangeError("Body ID is not in use.");
+	body->layer = layer;
+	body->mask = mask;
+	return JS_UNDEFINED;
+}
+
+JS_value CollisionWorld_remove(NativeCollisionWorld *world, int id) {
+	CollisionBody *body = getBody(world, id);
+	if (body == NULL) return RangeError("Body ID is not in use.");
+	if (body->sprite != NULL) jerry_release_value(body->spriteObj);
+	body->used = false;
+	body->sprite = NULL;
+	return JS_UNDEFINED;
+}
+
+void CollisionWorld_update(NativeCollisionWorld *world) {
+	collisionWorldUpdate(world);
+}
+
+JS_value CollisionWorld_get_pairs(NativeCollisionWorld *world) {
+	jerry_value_t pairsArr = jerry_create_typedarray(JERRY_TYPEDARRAY_UINT16, world->pairs.size());
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(pairsArr, &byteOffset, &byteLength);
+	jerry_arraybuffer_write(arrayBuffer, byteOffset, (u8 *) world->pairs.data(), byteLength);
+	jerry_release_value(arrayBuffer);
+	return pairsArr;
+}
+
+void exposeCollisionAPI(jerry_value_t global) {
+	jerry_value_t EventTarget = getProperty(global, "EventTarget");
+	jerry_value_t eventTargetPrototype = getProperty(EventTarget, "prototype");
+	JS_class CollisionWorld = extendClass(global, "CollisionWorld", CollisionWorldConstructor, eventTargetPrototype);
+	jerry_release_value(eventTargetPrototype);
+	jerry_release_value(EventTarget);
+	setMethod(CollisionWorld.prototype, "addSprite", bindMethod<CollisionWorld_addSprite>);
+	setMethod(CollisionWorld.prototype, "addBox", bindMethod<CollisionWorld_addBox>);
+	setMethod(CollisionWorld.prototype, "setBox", bindMethod<CollisionWorld_setBox>);
+	setMethod(CollisionWorld.prototype, "setLayers", bindMethod<CollisionWorld_setLayers>);
+	setMethod(CollisionWorld.prototype, "remove", bindMethod<CollisionWorld_remove>);
+	setMethod(CollisionWorld.prototype, "update", bindMethod<CollisionWorld_update>);
+	defGetter(CollisionWorld.prototype, "pairs", bindMethod<CollisionWorld_get_pairs>);
+	ref_CollisionWorld = CollisionWorld;
+}
+
+void releaseCollisionReferences() {
+	releaseClass(ref_CollisionWorld);
+}
\ No newline at end of file
@@ -70,6 +70,7 @@ void handleError(jerry_value_t error, bool sync) {
 		putchar('\n');
 		consoleSetColor(previousColor);
 		consoleSetBackground(previousBG);
+		consoleLogFlush();
 		if (!inREPL) abortFlag = true;
 	}
 }
@@ -97,6 +98,7 @@ void handleRejection(jerry_value_t promise) {
 		consoleSetColor(previousColor);
 		consoleSetBackground(previousBG);
 		jerry_release_value(reasonVal);
+		consoleLogFlush();
 		if (!inREPL) abortFlag = true;
 	}
 }
@@ -7,7 +7,11 @@
 #include <string.h>
 #include <time.h>
 
+#include "background.hpp"
+#include "bitmap.hpp"
+#include "collision.hpp"
 #include "error.hpp"
+#include "hblank.hpp"
 #include "io/console.hpp"
 #include "io/keyboard.hpp"
 #include "logging.hpp"
@@ -24,6 +28,7 @@ bool inREPL = false;
 bool abortFlag = false;
 bool userClosed = false;
 u8 dependentEvents = 0;
+u32 nativeListeners = 0;
 
 std::queue<Task> taskQueue;
 
@@ -113,6 +118,29 @@ jerry_value_t createEvent(const char *type, bool cancelable) {
 	return event;
 }
 
+// Listener count of a native object whose events keep the event loop running, or NULL if target isn't one.
+u16 *nativeListenerCount(jerry_value_t target) {
+	NativeSprite *sprite = getNative<NativeSprite>(target);
+	if (sprite != NULL) return sprite->removed ? NULL : &sprite->listenerCount;
+	return collisionListenerCount(target);
+}
+void countNativeListener(jerry_value_t target, bool added) {
+	u16 *listenerCount = nativeListenerCount(target);
+	if (listenerCount == NULL) return;
+	if (added) {
+		(*listenerCount)++;
+		nativeListeners++;
+	}
+	else {
+		(*listenerCount)--;
+		nativeListeners--;
+	}
+}
+void releaseNativeListeners(u16 &listenerCount) {
+	nativeListeners -= listenerCount;
+	listenerCount = 0;
+}
+
 /**
  * Dispatches event onto target.
  * If sync is true, runs "synchronously" (no microtasks are run). JS functions should set it to true.
@@ -141,6 +169,7 @@ bool dispatchEvent(jerry_value_t target, jerry_value_t event, bool sync) {
 				if (testProperty(listenerObj, onceProp)) {
 					arraySplice(listenersArr, i, 1);
 					jerry_release_value(jerry_set_property(listenerObj, ref_str_removed, JS_TRUE));
+					countNativeListener(target, false);
 				}
 				
 				jerry_value_t callbackVal = jerry_get_property(listenerObj, callbackProp);
@@ -174,6 +203,16 @@ bool dispatchEvent(jerry_value_t target, jerry_value_t event, bool sync) {
 	return testInternal(event, "defaultPrevented");
 }
 
+// Whether any listeners for the given event type are registered on target.
+bool hasEventListeners(jerry_value_t target, const char *type) {
+	jerry_value_t eventListenersObj = getInternal(target, "eventListeners");
+	jerry_value_t listenersArr = getProperty(eventListenersObj, type);
+	bool result = jerry_value_is_array(listenersArr) && jerry_get_array_length(listenersArr) > 0;
+	jerry_release_value(listenersArr);
+	jerry_release_value(eventListenersObj);
+	return result;
+}
+
 // Task which dispatches an event. Args: EventTarget, Event, optional callbackFunc
 void dispatchEventTask(const jerry_value_t *args, u32 argCount) {
 	bool canceled = dispatchEvent(args[0], args[1], false);
@@ -203,20 +242,26 @@ void queueEventName(const char *eventName, jerry_external_handler_t callback) {
  * Returns when there is no work left to do (not in the REPL and no tasks/timeouts left to execute) or when abortFlag is set.
  */
 void eventLoop() {
-	while (!abortFlag && (inREPL || dependentEvents || taskQueue.size() > 0 || timeoutsExist())) {
+	while (!abortFlag && (inREPL || dependentEvents || nativeListeners || taskQueue.size() > 0 || timeoutsExist() || backgroundSwapPending())) {
 		swiWaitForVBlank();
+		backgroundUpdate();
+		hblankUpdate();
 		if (dependentEvents & vblank) queueEventName("vblank");
 		scanKeys();
 		if (keysDown() & KEY_LID) queueSleepEvent();
 		if (keysUp() & KEY_LID) queueEventName("wake");
 		if (dependentEvents & (buttondown)) queueButtonEvents(true);
 		if (dependentEvents & (buttonup)) queueButtonEvents(false);
-		if (dependentEvents & (touchstart | touchmove | touchend)) queueTouchEvents();
+		queueTouchEvents();
 		timeoutUpdate();
 		runTasks();
 		spriteUpdate();
+		collisionUpdate();
+		bitmapUpdate();
 		keyboardUpdate();
+		consoleLogUpdate();
 		if (inREPL) {
+			consoleUpdate();
 			if (keyboardComposeStatus() == KEYBOARD_INACTIVE) {
 				putchar('>'); putchar(' ');
 				keyboardCompose(false);
@@ -225,7 +270,7 @@ void eventLoop() {
 				char *response;
 				u32 responseSize;
 				keyboardComposeAccept(&response, &responseSize);
-				printf(response);
+				fwrite(response, 1, responseSize, stdout);
 				putchar('\n');
 				jerry_value_t parsedCode = jerry_parse(
 					(const jerry_char_t *) "REPL", 4,
@@ -346,6 +391,7 @@ FUNCTION(EventTarget_addEventListener) {
 			else if (strcmp(type, "keyup") == 0) dependentEvents |= keyup;
 			free(type);
 		}
+		else countNativeListener(targetObj, true);
 	}
 
 	jerry_release_value(listenersArr);
@@ -376,6 +422,7 @@ FUNCTION(EventTarget_removeEventListener) {
 				arraySplice(listenersArr, i, 1);
 				jerry_release_value(jerry_set_property(storedListenerObj, ref_str_removed, JS_TRUE));
 				removed = true;
+				countNativeListener(targetObj, false);
 				if (targetObj == ref_global && jerry_get_array_length(listenersArr) == 0) {
 					char *type = rawString(typeStr);
 					if (strcmp(type, "vblank") == 0) dependentEvents &= ~(vblank);
@@ -23,10 +23,16 @@ JS_class ref_File;
 jerry_value_t ref_storage;
 char storagePath[PATH_MAX];
 
-void onFileFree(void *file) {
-	fclose((FILE *) file);
-}
-jerry_object_native_info_t fileNativeInfo = {.free_cb = onFileFree};
+struct NativeFile {
+	FILE *file; // NULL once closed
+	char mode[3];
+	bool canRead;
+	bool canWrite;
+
+	~NativeFile() {
+		if (file != NULL) fclose(file);
+	}
+};
 
 
 bool sortDirectoriesFirst(dirent left, dirent right) {
@@ -259,18 +265,15 @@ bool storageSave() {
 
 
 FUNCTION(File_read) {
+	NATIVE_THIS(NativeFile, native);
 	REQUIRE(1);
-
-	char *mode = getInternalString(thisValue, "mode");
-	bool unable = mode[0] != 'r' && mode[1] != '+';
-	free(mode);
-	if (unable)	return Error("Unable to read in current file mode.");
+	if (native->file == NULL) return Error("File is closed.");
+	if (!native->canRead) return Error("Unable to read in current file mode.");
 	
 	jerry_length_t bytesToRead = jerry_value_as_uint32(args[0]);
 	jerry_value_t arrayBuffer = jerry_create_arraybuffer(bytesToRead);
 	u8 *buf = jerry_get_arraybuffer_pointer(arrayBuffer);
-	FILE *file;
-	jerry_get_object_native_pointer(thisValue, (void**) &file, &fileNativeInfo);
+	FILE *file = native->file;
 	u32 bytesRead = fread(buf, 1, bytesToRead, file);
 	if (ferror(file)) {
 		jerry_release_value(arrayBuffer);
@@ -288,20 +291,17 @@ FUNCTION(File_read) {
 }
 
 FUNCTION(File_write) {
+	NATIVE_THIS(NativeFile, native);
 	REQUIRE(1);
 	EXPECT(jerry_get_typedarray_type(args[0]) == JERRY_TYPEDARRAY_UINT8, Uint8Array);
-
-	char *mode = getInternalString(thisValue, "mode");
-	bool unable = mode[0] != 'w' && mode[0] != 'a' && mode[1] != '+';
-	free(mode);
-	if (unable) return Error("Unable to write in current file mode.");
+	if (native->file == NULL) return Error("File is closed.");
+	if (!native->canWrite) return Error("Unable to write in current file mode.");
 	
 	jerry_length_t offset, bufSize;
 	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(args[0], &offset, &bufSize);
 	u8 *buf = jerry_get_arraybuffer_pointer(arrayBuffer) + offset;
 	jerry_release_value(arrayBuffer);
-	FILE *file;
-	jerry_get_object_native_pointer(thisValue, (void**) &file, &fileNativeInfo);
+	FILE *file = native->file;
 
 	u32 bytesWritten = fwrite(buf, 1, bufSize, file);
 	if (ferror(file)) {
@@ -311,7 +311,9 @@ FUNCTION(File_write) {
 }
 
 FUNCTION(File_seek) {
+	NATIVE_THIS(NativeFile, native);
 	REQUIRE(1);
+	if (native->file == NULL) return Error("File is closed.");
 
 	int mode = SEEK_SET;
 	if (argCount > 1) {
@@ -324,17 +326,17 @@ FUNCTION(File_seek) {
 	}
 	if (mode == 10) return TypeError("Invalid seek mode");
 
-	FILE *file;
-	jerry_get_object_native_pointer(thisValue, (void**) &file, &fileNativeInfo);
-	int success = fseek(file, jerry_value_as_int32(args[0]), mode);
+	int success = fseek(native->file, jerry_value_as_int32(args[0]), mode);
 	if (success != 0) return Error("File seek failed.");
 	return JS_UNDEFINED;
 }
 
 FUNCTION(File_close) {
-	FILE *file;
-	jerry_get_object_native_pointer(thisValue, (void**) &file, &fileNativeInfo);
-	if (fclose(file) != 0) return Error("File close failed.");
+	NATIVE_THIS(NativeFile, native);
+	if (native->file == NULL) return JS_UNDEFINED;
+	int status = fclose(native->file);
+	native->file = NULL;
+	if (status != 0) return Error("File close failed.");
 	return JS_UNDEFINED;
 }
 
@@ -362,12 +364,15 @@ FUNCTION(File_static_open) {
 		return Error("Unable to open file.");
 	}
 	else {
-		jerry_value_t modeStr = String(mode);
 		jerry_value_t fileObj = jerry_create_object();
 		setPrototype(fileObj, ref_File.prototype);
-		jerry_set_object_native_pointer(fileObj, file, &fileNativeInfo);
-		defReadonly(fileObj, "mode", modeStr);
-		jerry_release_value(modeStr);
+		NativeFile *native = setNative(fileObj, new NativeFile{
+			.file = file,
+			.mode = {0},
+			.canRead = mode[0] == 'r' || mode[1] == '+',
+			.canWrite = mode[0] != 'r' || mode[1] == '+'
+		});
+		strcpy(native->mode, mode);
 		if (mode != defaultMode) free(mode);
 		free(path);
 		return fileObj;
@@ -666,6 +671,7 @@ void exposeFileAPI(jerry_value_t global) {
 	setMethod(File.prototype, "write", File_write);
 	setMethod(File.prototype, "seek", File_seek);
 	setMethod(File.prototype, "close", File_close);
+	defNativeGetter<&NativeFile::mode>(File.prototype, "mode");
 	setMethod(File.constructor, "open", File_static_open);
 	setMethod(File.constructor, "copy", File_static_copy);
 	setMethod(File.constructor, "rename", File_static_rename);
@@ -0,0 +1,166 @@
+#include "hblank.hpp"
+
+#include <nds/arm9/background.h>
+#include <nds/arm9/video.h>
+#include <nds/interrupts.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "background.hpp"
+#include "sprite.hpp"
+#include "util/helpers.hpp"
+
+
+
+JS_class ref_HBlankEffect;
+const u16 LINES_PER_FRAME = 263;
+const u8 MAX_ENABLED_EFFECTS = 16;
+// Read by the HBlank interrupt, so only changed with interrupts disabled.
+NativeHBlankEffect *enabledEffects[MAX_ENABLED_EFFECTS];
+u8 enabledEffectCount = 0;
+
+/* Each hblank sets up the line after it, the last one in the frame doing the top line.
+ * The interrupt also fires through vblank, which leaves enough lines to copy the tables between frames.
+ */
+void hblankInterrupt() {
+	spriteHBlank();
+	u16 line = REG_VCOUNT + 1;
+	if (line == LINES_PER_FRAME) line = 0;
+	else if (line >= SCREEN_HEIGHT) return;
+	for (u8 i = 0; i < enabledEffectCount; i++) {
+		NativeHBlankEffect *effect = enabledEffects[i];
+		if (effect->wide) *(vu32 *) effect->target = effect->values[line];
+		else *(vu16 *) effect->target = ((const u16 *) effect->values)[line];
+	}
+}
+
+void hblankInterruptUpdate() {
+	if (enabledEffectCount > 0 || spriteMultiplexing()) irqEnable(IRQ_HBLANK);
+	else irqDisable(IRQ_HBLANK);
+}
+
+void copyTable(NativeHBlankEffect *effect) {
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(effect->table, &byteOffset, &byteLength);
+	u8 *data = jerry_get_arraybuffer_pointer(arrayBuffer);
+	jerry_release_value(arrayBuffer);
+	if (data != NULL) memcpy(effect->values, data + byteOffset, SCREEN_HEIGHT * (effect->wide ? 4 : 2));
+}
+
+void hblankUpdate() {
+	for (u8 i = 0; i < enabledEffectCount; i++) copyTable(enabledEffects[i]);
+}
+
+void setEnabled(NativeHBlankEffect *effect, bool enabled) {
+	u32 oldIME = enterCriticalSection();
+	if (enabled) enabledEffects[enabledEffectCount++] = effect;
+	else {
+		u8 i = 0;
+		while (enabledEffects[i] != effect) i++;
+		enabledEffectCount--;
+		for (; i < enabledEffectCount; i++) enabledEffects[i] = enabledEffects[i + 1];
+	}
+	effect->enabled = enabled;
+	leaveCriticalSection(oldIME);
+	hblankInterruptUpdate();
+}
+
+NativeHBlankEffect::~NativeHBlankEffect() {
+	if (enabled) setEnabled(this, false);
+	jerry_release_value(table);
+}
+
+// Finds the register for a property of a background or background engine. Returns an error if there isn't one.
+jerry_value_t findTarget(jerry_value_t targetObj, const char *property, volatile void **target, bool *wide) {
+	*wide = false;
+	NativeBackground *bg = getNative<NativeBackground>(targetObj);
+	if (bg != NULL) {
+		if (bg->removed) return TypeError(WAS_REMOVED);
+		if (bg->type == BgType_Text4bpp || bg->type == BgType_Text8bpp) {
+			if (strcmp(property, "x") == 0) *target = &bgScrollTable[bg->id]->x;
+			else if (strcmp(property, "y") == 0) *target = &bgScrollTable[bg->id]->y;
+			else return TypeError("Expected a text background property of 'x' or 'y'.");
+			return JS_UNDEFINED;
+		}
+		// the reference point is fixed point with 8 fractional bits, and the matrix is the same as in rotateScale
+		bg_transform *transform = bgTransform[bg->id];
+		*wide = strcmp(property, "x") == 0 || strcmp(property, "y") == 0;
+		if (strcmp(property, "x") == 0) *target = &transform->dx;
+		else if (strcmp(property, "y") == 0) *target = &transform->dy;
+		else if (strcmp(property, "pa") == 0) *target = &transform->hdx;
+		else if (strcmp(property, "pb") == 0) *target = &transform->vdx;
+		else if (strcmp(property, "pc") == 0) *target = &transform->hdy;
+		else if (strcmp(property, "pd") == 0) *target = &transform->vdy;
+		else return TypeError("Expected an affine background property of 'x', 'y', 'pa', 'pb', 'pc', or 'pd'.");
+		return JS_UNDEFINED;
+	}
+	NativeBackgroundEngine *engine = getNative<NativeBackgroundEngine>(targetObj);
+	if (engine != NULL) {
+		if (strcmp(property, "backdrop") == 0) *target = engine->main ? &BG_PALETTE[0] : &BG_PALETTE_SUB[0];
+		else if (strcmp(property, "blendAlpha") == 0) *target = engine->main ? &REG_BLDALPHA : &REG_BLDALPHA_SUB;
+		else if (strcmp(property, "blendBrightness") == 0) *target = engine->main ? &REG_BLDY : &REG_BLDY_SUB;
+		else if (strcmp(property, "masterBrightness") == 0) *target = engine->main ? &REG_MASTER_BRIGHT : &REG_MASTER_BRIGHT_SUB;
+		else return TypeError("Expected an engine property of 'backdrop', 'blendAlpha', 'blendBrightness', or 'masterBrightness'.");
+		return JS_UNDEFINED;
+	}
+	return TypeError("Expected a Background or background engine as the target.");
+}
+
+JS_value HBlankEffect_set_enabled(NativeHBlankEffect *effect, bool enabled) {
+	if (enabled == effect->enabled) return JS_UNDEFINED;
+	if (enabled) {
+		if (enabledEffectCount == MAX_ENABLED_EFFECTS) return Error("Too many HBlank effects enabled.");
+		copyTable(effect);
+		jerry_acquire_value(effect->object);
+		setEnabled(effect, true);
+	}
+	else {
+		setEnabled(effect, false);
+		jerry_release_value(effect->object);
+	}
+	return JS_UNDEFINED;
+}
+
+FUNCTION(HBlankEffectConstructor) {
+	CONSTRUCTOR(HBlankEffect); REQUIRE(3);
+	volatile void *target = NULL;
+	bool wide;
+	char *property = toRawString(args[1]);
+	jerry_value_t error = findTarget(args[0], property, &target, &wide);
+	free(property);
+	if (jerry_value_is_error(error)) return error;
+	if (!jerry_value_is_typedarray(args[2])) return TypeError(wide ? "Expected an Int32Array or Uint32Array table." : "Expected an Int16Array or Uint16Array table.");
+	jerry_typedarray_type_t type = jerry_get_typedarray_type(args[2]);
+	if (wide ? type != JERRY_TYPEDARRAY_INT32 && type != JERRY_TYPEDARRAY_UINT32 : type != JERRY_TYPEDARRAY_INT16 && type != JERRY_TYPEDARRAY_UINT16) {
+		return TypeError(wide ? "Expected an Int32Array or Uint32Array table." : "Expected an Int16Array or Uint16Array table.");
+	}
+	if (jerry_get_typedarray_length(args[2]) < SCREEN_HEIGHT) return RangeError("Expected a table with an entry for each of the 192 lines.");
+	NativeHBlankEffect *effect = setNative(thisValue, new NativeHBlankEffect{
+		.object = thisValue,
+		.table = jerry_acquire_value(args[2]),
+		.target = target,
+		.wide = wide,
+		.enabled = false,
+		.values = {0}
+	});
+	return HBlankEffect_set_enabled(effect, true).value;
+}
+
+FUNCTION(HBlankEffect_get_table) {
+	NATIVE_THIS(NativeHBlankEffect, effect);
+	return jerry_acquire_value(effect->table);
+}
+
+void exposeHBlankAPI(jerry_value_t global) {
+	JS_class HBlankEffect = createClass(global, "HBlankEffect", HBlankEffectConstructor);
+	defGetterSetter(HBlankEffect.prototype, "enabled", nativeGetter<&NativeHBlankEffect::enabled>, bindMethod<HBlankEffect_set_enabled>);
+	defGetter(HBlankEffect.prototype, "table", HBlankEffect_get_table);
+	ref_HBlankEffect = HBlankEffect;
+	irqSet(IRQ_HBLANK, hblankInterrupt);
+}
+
+void releaseHBlankReferences() {
+	while (enabledEffectCount > 0) HBlankEffect_set_enabled(enabledEffects[enabledEffectCount - 1], false);
+	irqSet(IRQ_HBLANK, NULL);
+	releaseClass(ref_HBlankEffect);
+}
\ No newline at end of file
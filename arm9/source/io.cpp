@@ -102,7 +102,7 @@ FUNCTION(prompt) {
 		char *response;
 		u32 responseSize;
 		keyboardComposeAccept(&response, &responseSize);
-		printf(response); putchar('\n');
+		fwrite(response, 1, responseSize, stdout); putchar('\n');
 		jerry_value_t responseStr = StringSized(response, responseSize);
 		free(response);
 		keyboardUpdate();
@@ -381,6 +381,17 @@ FUNCTION(console_set_textBackground) {
 	return JS_UNDEFINED;
 }
 
+FUNCTION(console_set_logFile) {
+	if (jerry_value_is_null(args[0]) || jerry_value_is_undefined(args[0])) consoleSetLogFile(NULL);
+	else {
+		char *path = toRawString(args[0]);
+		bool opened = consoleSetLogFile(path);
+		free(path);
+		if (!opened) return Error("Unable to open log file.");
+	}
+	return JS_UNDEFINED;
+}
+
 void exposeIOAPI(jerry_value_t global) {
 	ref_consoleCounters = jerry_create_object();
 	ref_consoleTimers = jerry_create_object();
@@ -409,6 +420,7 @@ void exposeIOAPI(jerry_value_t global) {
 	setMethod(console, "warn", console_warn);
 	defGetterSetter(console, "textColor", RETURN(jerry_create_number(consoleGetColor())), console_set_textColor);
 	defGetterSetter(console, "textBackground", RETURN(jerry_create_number(consoleGetBackground())), console_set_textBackground);
+	defGetterSetter(console, "logFile", RETURN(consoleGetLogFile() ? String(consoleGetLogFile()) : JS_NULL), console_set_logFile);
 	jerry_release_value(console);
 
 	jerry_value_t keyboard = createObject(global, "keyboard");
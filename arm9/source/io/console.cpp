@@ -4,6 +4,7 @@
 #include <nds/arm9/video.h>
 #include <nds/arm9/cache.h>
 #include <nds/arm9/console.h>
+#include <nds/arm9/input.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +18,17 @@
 
 const int TAB_SIZE = 2;
 const int BUFFER_HEIGHT = SCREEN_HEIGHT;
+const int SCROLLBACK_SIZE = 0x4000; // in UTF-16 units
+const int SCROLLBACK_LINES = 512;
+const int SCROLLBACK_LINE_MAX = 1024; // text beyond this many units in a single line isn't stored
+const int SCROLL_REPEAT_START = 20;
+const int SCROLL_REPEAT_INTERVAL = 3;
+const char16_t COLOR_MARKER = 0xFFFF; // followed by text color and background color
+const int LOG_BUFFER_SIZE = 0x8000;
+const int LOG_FLUSH_SIZE = 0x1000; // written per frame by consoleLogUpdate
+const int LOG_FLUSH_FRAMES = 60; // frames before a partial buffer is written out
+const u16 DEFAULT_COLOR = 0xFFFF;
+const u16 DEFAULT_BACKGROUND = 0;
 
 char charBuffer[3];
 u8 charBufferLen = 0;
@@ -31,25 +43,146 @@ bool paused = false;
 NitroFont consoleFont = {0};
 u16 colors[4] = {0};
 
+/* Scrollback history, stored as text instead of pixels.
+ * Every line starts with a color marker, and another is added whenever the colors change mid-line.
+ */
+static char16_t scrollText[SCROLLBACK_SIZE] = {0};
+static u32 scrollLineStart[SCROLLBACK_LINES] = {0};
+u32 scrollEnd = 0;
+u32 lineNum = 0, firstLine = 0;
+u16 storedColor = 0, storedBackground = 0;
+bool markerNeeded = true;
+u32 scrolledBack = 0;
+int scrollHeldTime = 0;
+u16 scrollTouchY = 0;
+
+/* Console log file mirror.
+ * Output is collected in a ring buffer and written out a piece at a time, so it doesn't stall frames.
+ * Color changes are kept as ANSI escape codes.
+ */
+alignas(32) static char logBuffer[LOG_BUFFER_SIZE] = {0};
+u32 logStart = 0, logEnd = 0;
+int logIdleFrames = 0;
+FILE *logFile = NULL;
+char *logPath = NULL;
+u16 loggedColor = DEFAULT_COLOR, loggedBackground = DEFAULT_BACKGROUND;
+
+void makePalette(u16 *palette, u16 color, u16 background) {
+	palette[0] = background;
+	palette[1] = colorBlend(background, color, 20);
+	palette[2] = colorBlend(background, color, 80);
+	palette[3] = color;
+}
+
 u16 consoleSetColor(u16 color) {
 	u16 prev = colors[3];
-	colors[3] = color;
-	colors[2] = colorBlend(colors[0], color, 80);
-	colors[1] = colorBlend(colors[0], color, 20);
+	makePalette(colors, color, colors[0]);
 	return prev;
 }
 u16 consoleGetColor() { return colors[3]; }
 
 u16 consoleSetBackground(u16 color) {
 	u16 prev = colors[0];
-	colors[0] = color;
-	colors[1] = colorBlend(color, colors[3], 20);
-	colors[2] = colorBlend(color, colors[3], 80);
+	makePalette(colors, colors[3], color);
 	return prev;
 }
 u16 consoleGetBackground() { return colors[0]; }
 NitroFont consoleGetFont() { return consoleFont; }
 
+void scrollbackPushUnit(char16_t unit) {
+	scrollText[scrollEnd++ % SCROLLBACK_SIZE] = unit;
+	// forget the oldest lines once their text has been overwritten
+	while (firstLine < lineNum && scrollEnd - scrollLineStart[firstLine % SCROLLBACK_LINES] > SCROLLBACK_SIZE) firstLine++;
+}
+void scrollbackMark() {
+	if (!markerNeeded && storedColor == colors[3] && storedBackground == colors[0]) return;
+	scrollbackPushUnit(COLOR_MARKER);
+	scrollbackPushUnit(storedColor = colors[3]);
+	scrollbackPushUnit(storedBackground = colors[0]);
+	markerNeeded = false;
+}
+void scrollbackPush(char16_t codepoint) {
+	if (scrollEnd - scrollLineStart[lineNum % SCROLLBACK_LINES] >= SCROLLBACK_LINE_MAX) return;
+	scrollbackMark();
+	scrollbackPushUnit(codepoint == COLOR_MARKER ? REPLACEMENT_CHAR : codepoint);
+}
+void scrollbackNewLine() {
+	scrollbackMark();
+	lineNum++;
+	if (lineNum - firstLine >= SCROLLBACK_LINES) firstLine = lineNum - SCROLLBACK_LINES + 1;
+	scrollLineStart[lineNum % SCROLLBACK_LINES] = scrollEnd;
+	markerNeeded = true;
+}
+
+// Renders stored line n into the buffer row starting at y, clipping anything past the screen width.
+void renderStoredLine(u32 n, int y) {
+	u16 *row = gfxBuffer + y * SCREEN_WIDTH;
+	memset16(row, 0, SCREEN_WIDTH * consoleFont.tileHeight);
+	if (n < firstLine || n > lineNum) return;
+
+	u32 pos = scrollLineStart[n % SCROLLBACK_LINES];
+	u32 end = n == lineNum ? scrollEnd : scrollLineStart[(n + 1) % SCROLLBACK_LINES];
+	u16 palette[4] = {0};
+	u32 x = 0;
+	while (pos < end) {
+		char16_t codepoint = scrollText[pos++ % SCROLLBACK_SIZE];
+		if (codepoint == COLOR_MARKER) {
+			u16 color = scrollText[pos++ % SCROLLBACK_SIZE];
+			makePalette(palette, color, scrollText[pos++ % SCROLLBACK_SIZE]);
+		}
+		else if (codepoint == '\t') {
+			u8 tabWidth = fontGetCodePointWidth(consoleFont, ' ') * TAB_SIZE;
+			x = (x / tabWidth + 1) * tabWidth;
+		}
+		else {
+			u8 width = fontGetCodePointWidth(consoleFont, codepoint);
+			if (x + width > SCREEN_WIDTH) break;
+			fontPrintCodePoint(consoleFont, palette, codepoint, gfxBuffer, SCREEN_WIDTH, x, y);
+			x += width;
+		}
+	}
+	if (palette[0] && x < SCREEN_WIDTH) for (u8 i = 0; i < consoleFont.tileHeight; i++) {
+		memset16(row + i * SCREEN_WIDTH + x, palette[0], SCREEN_WIDTH - x);
+	}
+}
+
+void logWriteOut(u32 size) {
+	while (size > 0) {
+		u32 offset = logStart % LOG_BUFFER_SIZE;
+		u32 chunk = LOG_BUFFER_SIZE - offset < size ? LOG_BUFFER_SIZE - offset : size;
+		fwrite(logBuffer + offset, 1, chunk, logFile);
+		logStart += chunk;
+		size -= chunk;
+	}
+}
+void logPut(const char *data, u32 size) {
+	while (size > 0) {
+		if (logEnd - logStart == LOG_BUFFER_SIZE) logWriteOut(LOG_BUFFER_SIZE);
+		u32 offset = logEnd % LOG_BUFFER_SIZE;
+		u32 space = LOG_BUFFER_SIZE - (logEnd - logStart);
+		if (LOG_BUFFER_SIZE - offset < space) space = LOG_BUFFER_SIZE - offset;
+		u32 chunk = space < size ? space : size;
+		memcpy(logBuffer + offset, data, chunk);
+		logEnd += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+}
+void logWrite(const char *message, size_t len) {
+	if (colors[3] != loggedColor || colors[0] != loggedBackground) {
+		loggedColor = colors[3];
+		loggedBackground = colors[0];
+		char marker[48];
+		if (loggedColor == DEFAULT_COLOR && loggedBackground == DEFAULT_BACKGROUND) strcpy(marker, "\x1b[0m");
+		else sprintf(marker, "\x1b[38;2;%d;%d;%d;48;2;%d;%d;%dm",
+			(loggedColor & 0x1F) << 3, (loggedColor >> 5 & 0x1F) << 3, (loggedColor >> 10 & 0x1F) << 3,
+			(loggedBackground & 0x1F) << 3, (loggedBackground >> 5 & 0x1F) << 3, (loggedBackground >> 10 & 0x1F) << 3
+		);
+		logPut(marker, strlen(marker));
+	}
+	logPut(message, len);
+}
+
 void consoleDraw() {
 	int pos = linePos + consoleFont.tileHeight;
 	if (pos <= consoleHeight) dmaCopyWords(0, gfxBuffer, bgGetGfxPtr(7), pos * SCREEN_WIDTH * sizeof(u16));
@@ -78,6 +211,7 @@ void newLine() {
 		memset16(gfxBuffer + (((linePos + i) % BUFFER_HEIGHT) * SCREEN_WIDTH) + lineWidth, colors[0], SCREEN_WIDTH - lineWidth);
 	}
 	DC_FlushRange(gfxBuffer + (linePos % BUFFER_HEIGHT) * SCREEN_WIDTH, consoleFont.tileHeight * SCREEN_WIDTH * sizeof(u16));
+	scrollbackNewLine();
 	lineWidth = 0;
 	linePos += consoleFont.tileHeight;
 	memset16(gfxBuffer + ((linePos % BUFFER_HEIGHT) * SCREEN_WIDTH), 0, SCREEN_WIDTH * consoleFont.tileHeight);
@@ -89,6 +223,7 @@ bool writeCodepoint(char16_t codepoint) {
 		return true;
 	}
 	else if (codepoint == '\t') {
+		scrollbackPush(codepoint);
 		u8 tabWidth = fontGetCodePointWidth(consoleFont, ' ') * TAB_SIZE;
 		lineWidth = (lineWidth / tabWidth + 1) * tabWidth;
 		if (lineWidth > SCREEN_WIDTH) {
@@ -106,6 +241,7 @@ bool writeCodepoint(char16_t codepoint) {
 	}
 
 	fontPrintCodePoint(consoleFont, colors, codepoint, gfxBuffer, SCREEN_WIDTH, lineWidth, linePos % BUFFER_HEIGHT);
+	scrollbackPush(codepoint);
 
 	lineWidth += width;
 	return newLined;
@@ -113,6 +249,11 @@ bool writeCodepoint(char16_t codepoint) {
 
 ssize_t writeIn(const char* message, size_t len) {
 	bool fullUpdate = false;
+	if (logFile) logWrite(message, len);
+	if (scrolledBack) {
+		consoleScroll(-scrolledBack);
+		fullUpdate = true;
+	}
 	for (size_t i = 0; i < len; i++) {
 		char16_t codepoint = 0;
 		if (charBufferLen == 0 && message[i] < 0x80) {
@@ -151,11 +292,37 @@ void consoleInit(NitroFont font) {
 	setvbuf(stdout, NULL, _IONBF, 0);
 	setvbuf(stderr, NULL, _IONBF, 0);
 	consoleFont = font;
-	consoleSetColor(0xFFFF);
+	consoleSetColor(DEFAULT_COLOR);
+}
+
+// Decodes one codepoint from null terminated UTF-8 and advances past it, with the same limits as writeIn.
+char16_t nextCodepoint(const char *&str) {
+	u8 byte = *(str++);
+	u8 length = byte < 0x80 ? 0 : byte < 0xE0 ? 1 : byte < 0xF0 ? 2 : 3;
+	char16_t codepoint = length == 0 ? byte : length == 1 ? byte & 0b11111 : byte & 0xF;
+	for (u8 i = 0; i < length; i++) {
+		if (*str == 0) return 0xFFFD;
+		codepoint = codepoint << 6 | (*(str++) & 0b111111);
+	}
+	return length == 3 ? 0xFFFD : codepoint;
 }
 
 void consolePrintNoWrap(const char *message, bool scroll) {
-	fontPrintString(consoleFont, colors, message, gfxBuffer, SCREEN_WIDTH, lineWidth, linePos % BUFFER_HEIGHT, SCREEN_WIDTH - lineWidth, scroll);
+	if (scrolledBack) consoleScroll(-scrolledBack);
+	if (scroll) {
+		// skip leading characters until the rest fits, so the end stays visible
+		u32 totalWidth = 0;
+		for (const char *ptr = message; *ptr;) totalWidth += fontGetCodePointWidth(consoleFont, nextCodepoint(ptr));
+		while (*message && lineWidth + totalWidth > SCREEN_WIDTH) totalWidth -= fontGetCodePointWidth(consoleFont, nextCodepoint(message));
+	}
+	while (*message) {
+		char16_t codepoint = nextCodepoint(message);
+		u8 width = fontGetCodePointWidth(consoleFont, codepoint);
+		if (lineWidth + width > SCREEN_WIDTH) break;
+		fontPrintCodePoint(consoleFont, colors, codepoint, gfxBuffer, SCREEN_WIDTH, lineWidth, linePos % BUFFER_HEIGHT);
+		scrollbackPush(codepoint);
+		lineWidth += width;
+	}
 	if (!paused) consoleDrawLine();
 }
 
@@ -172,6 +339,9 @@ void consoleClean() {
 	memset(gfxBuffer, 0, sizeof(gfxBuffer));
 	if (!paused) dmaFillWords(0, bgGetGfxPtr(7), SCREEN_WIDTH * consoleHeight * sizeof(u16));
 	lineWidth = linePos = 0;
+	scrollEnd = lineNum = firstLine = scrolledBack = 0;
+	scrollLineStart[0] = 0;
+	markerNeeded = true;
 }
 void consoleShrink() {
 	consoleHeight = SCREEN_HEIGHT / 2;
@@ -183,4 +353,92 @@ void consoleShrink() {
 void consoleExpand() {
 	consoleHeight = SCREEN_HEIGHT;
 	if (!paused) consoleDraw();
+}
+
+/* Moves the view through the scrollback history by some number of lines (positive is further back).
+ * The visible rows of the buffer are re-rendered from the stored text.
+ */
+void consoleScroll(int lines) {
+	u32 visibleLines = consoleHeight / consoleFont.tileHeight;
+	u32 storedLines = lineNum - firstLine + 1;
+	u32 maxScroll = storedLines > visibleLines ? storedLines - visibleLines : 0;
+	int target = (int) scrolledBack + lines;
+	if (target < 0) target = 0;
+	if ((u32) target > maxScroll) target = maxScroll;
+	if ((u32) target == scrolledBack) return;
+	scrolledBack = target;
+
+	for (u32 i = 0; i < BUFFER_HEIGHT / consoleFont.tileHeight && i <= lineNum; i++) {
+		renderStoredLine(lineNum - i - scrolledBack, (linePos - i * consoleFont.tileHeight) % BUFFER_HEIGHT);
+	}
+	DC_FlushRange(gfxBuffer, sizeof(gfxBuffer));
+	if (!paused) consoleDraw();
+}
+
+// Scrolls through the history with L/R, or by dragging the touch screen while holding either.
+void consoleUpdate() {
+	u32 held = keysHeld();
+	if (held & (KEY_L | KEY_R)) {
+		int direction = held & KEY_L ? 1 : -1;
+		if (keysDown() & (KEY_L | KEY_R)) {
+			scrollHeldTime = 0;
+			consoleScroll(direction);
+		}
+		else if (++scrollHeldTime >= SCROLL_REPEAT_START && (scrollHeldTime - SCROLL_REPEAT_START) % SCROLL_REPEAT_INTERVAL == 0) {
+			scrollHeldTime = SCROLL_REPEAT_START;
+			consoleScroll(direction);
+		}
+
+		if (held & KEY_TOUCH) {
+			touchPosition pos;
+			touchRead(&pos);
+			if (keysDown() & KEY_TOUCH) scrollTouchY = pos.py;
+			int lines = ((int) pos.py - (int) scrollTouchY) / consoleFont.tileHeight;
+			if (lines != 0) {
+				consoleScroll(lines);
+				scrollTouchY += lines * consoleFont.tileHeight;
+			}
+		}
+	}
+	else scrollHeldTime = 0;
+}
+
+bool consoleSetLogFile(const char *path) {
+	// flushed first, so output stays in order when reopening the same file
+	consoleLogFlush();
+	FILE *newFile = NULL;
+	if (path != NULL) {
+		newFile = fopen(path, "a");
+		if (newFile == NULL) return false;
+		setvbuf(newFile, NULL, _IONBF, 0);
+	}
+	if (logFile) {
+		fclose(logFile);
+		free(logPath);
+	}
+	logFile = newFile;
+	logPath = path == NULL ? NULL : strdup(path);
+	logStart = logEnd = 0;
+	logIdleFrames = 0;
+	loggedColor = DEFAULT_COLOR;
+	loggedBackground = DEFAULT_BACKGROUND;
+	return true;
+}
+const char *consoleGetLogFile() { return logPath; }
+
+void consoleLogFlush() {
+	if (!logFile) return;
+	logWriteOut(logEnd - logStart);
+	fflush(logFile);
+	logIdleFrames = 0;
+}
+
+// Writes out the log a piece at a time, or everything once it has sat idle for a while.
+void consoleLogUpdate() {
+	if (!logFile || logEnd == logStart) return;
+	if (logEnd - logStart >= LOG_FLUSH_SIZE) {
+		logWriteOut(LOG_FLUSH_SIZE);
+		logIdleFrames = 0;
+	}
+	else if (++logIdleFrames >= LOG_FLUSH_FRAMES) consoleLogFlush();
 }
\ No newline at end of file
@@ -396,7 +396,22 @@ const char16_t semivoiced[]    = u"ぱぴぷぺぽぱぴぷぺぽパピプペポ
 const char16_t shrinkable[] = u"あいうえおつづやゆよわアイウヴエオツヅヤユヨワカガケゲ";
 const char16_t shrunk[]     = u"ぁぃぅぇぉっっゃゅょゎァィゥゥェォッッャュョヮヵヵヶヶ";
 
-static u16 gfxKbdBuffer[SCREEN_WIDTH * KEYBOARD_HEIGHT] = {0};
+/* Boards are rendered once per board and shift state, then kept around to be copied in as they are.
+ * Only the current board and the last one switched away from are kept, since each takes 40KB.
+ * Keys drawn in any other state are rendered on their own into gfxKeyBuffer.
+ */
+const u8 BOARD_CACHE_SIZE = 2;
+struct RenderedBoard {
+	bool valid;
+	u8 board;
+	bool shift, caps, cancel;
+	u32 lastUsed;
+};
+static u16 gfxBoardCache[BOARD_CACHE_SIZE][SCREEN_WIDTH * KEYBOARD_HEIGHT] = {0};
+RenderedBoard renderedBoards[BOARD_CACHE_SIZE] = {0};
+u32 boardUseCount = 0;
+u16 *gfxKbdBuffer = gfxBoardCache[0];
+static u16 gfxKeyBuffer[SCREEN_WIDTH * TALL_ENTER_HEIGHT] = {0};
 static u16 gfxCmpBuffer[SCREEN_WIDTH * TEXT_HEIGHT] = {0};
 char16_t compositionBuffer[256] = {0};
 NitroFont keyFont = {0};
@@ -443,40 +458,68 @@ bool keyIsActive(KeyDef key) {
 		|| (currentBoard == key.lower - INPUT_ALPHANUMERIC);
 }
 
-void renderKey(KeyDef key, u8 keyWidth, u8 keyHeight, u8 palIdx) {
+// Renders a key into a buffer that is SCREEN_WIDTH wide and starts at row originY of the keyboard.
+void renderKey(KeyDef key, u8 keyWidth, u8 keyHeight, u8 palIdx, u16 *buffer, u8 originY) {
 	if (key.lower == CANCEL && !cancelEnabled) return;
 	u16 color = (key.lower == CANCEL ? PALETTE_KEY_CANCEL : (key.lower < '!' || key.lower == u'　' ? PALETTE_KEY_SPECIAL : PALETTE_KEY_NORMAL))[palIdx];
 	for (u8 y = 0; y < keyHeight && key.y + y < KEYBOARD_HEIGHT-1; y++) {
-		memset16(gfxKbdBuffer + key.x + (key.y + y) * SCREEN_WIDTH, color, keyWidth);
+		memset16(buffer + key.x + (key.y - originY + y) * SCREEN_WIDTH, color, keyWidth);
 	}
 	char16_t codepoint = shiftToggle != capsToggle ? key.upper : key.lower;
 	if (codepoint == '\n' && currentBoard > 0) {
 		// hardcoded set of extra tiles that form the tall enter graphic
-		fontPrintCodePoint(keyFont, PALETTE_FONT_KEY, 0x1E, gfxKbdBuffer, SCREEN_WIDTH, key.x + (keyWidth - fontGetCodePointWidth(keyFont, 0x1E)) / 2, key.y);
-		fontPrintCodePoint(keyFont, PALETTE_FONT_KEY, 0x1F, gfxKbdBuffer, SCREEN_WIDTH, key.x + (keyWidth - fontGetCodePointWidth(keyFont, 0x1F)) / 2, key.y + keyFont.tileHeight);
+		fontPrintCodePoint(keyFont, PALETTE_FONT_KEY, 0x1E, buffer, SCREEN_WIDTH, key.x + (keyWidth - fontGetCodePointWidth(keyFont, 0x1E)) / 2, key.y - originY);
+		fontPrintCodePoint(keyFont, PALETTE_FONT_KEY, 0x1F, buffer, SCREEN_WIDTH, key.x + (keyWidth - fontGetCodePointWidth(keyFont, 0x1F)) / 2, key.y - originY + keyFont.tileHeight);
 	}
 	else {
 		u8 charWidth = fontGetCodePointWidth(keyFont, codepoint);
-		fontPrintCodePoint(keyFont, PALETTE_FONT_KEY, codepoint, gfxKbdBuffer, SCREEN_WIDTH, key.x + (keyWidth - charWidth) / 2, key.y);
+		fontPrintCodePoint(keyFont, PALETTE_FONT_KEY, codepoint, buffer, SCREEN_WIDTH, key.x + (keyWidth - charWidth) / 2, key.y - originY);
 	}
 }
 void drawSingleKey(KeyDef key, u8 keyWidth, u8 keyHeight, u8 palIdx) {
-	renderKey(key, keyWidth, keyHeight, palIdx);
-	DC_FlushRange(gfxKbdBuffer, sizeof(gfxKbdBuffer));
-	for (u8 y = 0; y < keyHeight && key.y + y < KEYBOARD_HEIGHT-1; y++) {
-		dmaCopy(gfxKbdBuffer + key.x + (key.y + y) * SCREEN_WIDTH, bgGetGfxPtr(7) + key.x + (SCREEN_WIDTH * (SCREEN_HEIGHT - KEYBOARD_HEIGHT + (key.y + y))), keyWidth * sizeof(u16));
+	if (key.lower == CANCEL && !cancelEnabled) return;
+	u8 rows = key.y + keyHeight < KEYBOARD_HEIGHT-1 ? keyHeight : KEYBOARD_HEIGHT-1 - key.y;
+	u16 *source = gfxKbdBuffer + key.y * SCREEN_WIDTH;
+	if (palIdx != (keyIsActive(key) ? ACTIVE : NEUTRAL)) {
+		// only this key's rows need rendering and flushing
+		renderKey(key, keyWidth, keyHeight, palIdx, gfxKeyBuffer, key.y);
+		DC_FlushRange(gfxKeyBuffer, rows * SCREEN_WIDTH * sizeof(u16));
+		source = gfxKeyBuffer;
+	}
+	for (u8 y = 0; y < rows; y++) {
+		dmaCopy(source + key.x + y * SCREEN_WIDTH, bgGetGfxPtr(7) + key.x + (SCREEN_WIDTH * (SCREEN_HEIGHT - KEYBOARD_HEIGHT + (key.y + y))), keyWidth * sizeof(u16));
 	}
 }
 void drawSelectedBoard() {
-	memset16(gfxKbdBuffer, COLOR_KEYBOARD_BACKDROP, SCREEN_WIDTH * KEYBOARD_HEIGHT);
-	for (int i = 0; i < boardSizes[currentBoard]; i++) {
-		KeyDef key = boards[currentBoard][i];
-		u8 keyWidth = calcKeyWidth(key, boards[currentBoard][(i + 1) % boardSizes[currentBoard]]);
-		u8 keyHeight = calcKeyHeight(key);
-		renderKey(key, keyWidth, keyHeight, i == highlightedKeyIdx ? HIGHLIGHTED : (keyIsActive(key) ? ACTIVE : NEUTRAL));
+	RenderedBoard *rendered = NULL;
+	for (u8 i = 0; i < BOARD_CACHE_SIZE; i++) {
+		RenderedBoard *test = renderedBoards + i;
+		if (test->valid && test->board == currentBoard && test->shift == shiftToggle && test->caps == capsToggle && test->cancel == cancelEnabled) {
+			rendered = test;
+			break;
+		}
+		if (rendered == NULL || !test->valid || (rendered->valid && test->lastUsed < rendered->lastUsed)) rendered = test;
+	}
+	gfxKbdBuffer = gfxBoardCache[rendered - renderedBoards];
+	rendered->lastUsed = ++boardUseCount;
+
+	if (!rendered->valid || rendered->board != currentBoard || rendered->shift != shiftToggle || rendered->caps != capsToggle || rendered->cancel != cancelEnabled) {
+		memset16(gfxKbdBuffer, COLOR_KEYBOARD_BACKDROP, SCREEN_WIDTH * KEYBOARD_HEIGHT);
+		for (int i = 0; i < boardSizes[currentBoard]; i++) {
+			KeyDef key = boards[currentBoard][i];
+			u8 keyWidth = calcKeyWidth(key, boards[currentBoard][(i + 1) % boardSizes[currentBoard]]);
+			u8 keyHeight = calcKeyHeight(key);
+			renderKey(key, keyWidth, keyHeight, keyIsActive(key) ? ACTIVE : NEUTRAL, gfxKbdBuffer, 0);
+		}
+		DC_FlushRange(gfxKbdBuffer, SCREEN_WIDTH * KEYBOARD_HEIGHT * sizeof(u16));
+		*rendered = {.valid = true, .board = currentBoard, .shift = shiftToggle, .caps = capsToggle, .cancel = cancelEnabled, .lastUsed = boardUseCount};
+	}
+	dmaCopy(gfxKbdBuffer, bgGetGfxPtr(7) + (SCREEN_WIDTH * (SCREEN_HEIGHT - KEYBOARD_HEIGHT)), SCREEN_WIDTH * KEYBOARD_HEIGHT * sizeof(u16));
+
+	if (highlightedKeyIdx != -1) {
+		KeyDef key = boards[currentBoard][highlightedKeyIdx];
+		drawSingleKey(key, calcKeyWidth(key, boards[currentBoard][(highlightedKeyIdx + 1) % boardSizes[currentBoard]]), calcKeyHeight(key), HIGHLIGHTED);
 	}
-	DC_FlushRange(gfxKbdBuffer, sizeof(gfxKbdBuffer));
-	dmaCopy(gfxKbdBuffer, bgGetGfxPtr(7) + (SCREEN_WIDTH * (SCREEN_HEIGHT - KEYBOARD_HEIGHT)), sizeof(gfxKbdBuffer));
 }
 void drawComposedText() {
 	memset16(gfxCmpBuffer, COLOR_COMPOSING_BACKDROP, SCREEN_WIDTH * TEXT_HEIGHT);
@@ -567,7 +610,8 @@ void holdKey() {
 void releaseKey() {
 	KeyDef key = boards[currentBoard][heldKeyIdx];
 	KeyDef nextKey = boards[currentBoard][(heldKeyIdx + 1) % boardSizes[currentBoard]];
-	bool updateBoard = true;
+	u8 prevBoard = currentBoard;
+	bool prevShift = shiftToggle, prevCaps = capsToggle;
 	if (key.lower == SHIFT) shiftToggle = !shiftToggle;
 	else if (key.lower == CAPS_LOCK) capsToggle = !capsToggle;
 	else if (key.lower == HIRAGANA) shiftToggle = false;
@@ -576,17 +620,13 @@ void releaseKey() {
 		currentBoard = key.lower - INPUT_ALPHANUMERIC;
 		shiftToggle = capsToggle = false;
 	}
-	else updateBoard = false;
 	char16_t codepoint = shiftToggle != capsToggle ? key.upper : key.lower;
 	bool canceled = false;
 	if (onRelease != NULL) canceled = onRelease(codepoint, key.name, shiftToggle != capsToggle, currentBoard);
 	if (!canceled && composing == KEYBOARD_COMPOSING && heldTime < REPEAT_START) composeKey(codepoint);
-	if (currentBoard == 0 && key.lower != SHIFT) {
-		shiftToggle = false;
-		updateBoard = true;
-	}
-	if (updateBoard) drawSelectedBoard();
-	else if (heldMode != B_PRESS) drawSingleKey(key, calcKeyWidth(key, nextKey), calcKeyHeight(key), heldKeyIdx == highlightedKeyIdx ? HIGHLIGHTED : NEUTRAL);
+	if (currentBoard == 0 && key.lower != SHIFT) shiftToggle = false;
+	if (currentBoard != prevBoard || shiftToggle != prevShift || capsToggle != prevCaps) drawSelectedBoard();
+	else if (heldMode != B_PRESS) drawSingleKey(key, calcKeyWidth(key, nextKey), calcKeyHeight(key), heldKeyIdx == highlightedKeyIdx ? HIGHLIGHTED : (keyIsActive(key) ? ACTIVE : NEUTRAL));
 	heldKeyIdx = -1;
 	heldTime = 0;
 	heldMode = NO_HOLD;
@@ -763,7 +803,7 @@ bool keyboardShow() {
 }
 bool keyboardHide() {
 	if (!showing) return false;
-	dmaFillHalfWords(0, bgGetGfxPtr(7) + (SCREEN_WIDTH * (SCREEN_HEIGHT - KEYBOARD_HEIGHT)), sizeof(gfxKbdBuffer));
+	dmaFillHalfWords(0, bgGetGfxPtr(7) + (SCREEN_WIDTH * (SCREEN_HEIGHT - KEYBOARD_HEIGHT)), SCREEN_WIDTH * KEYBOARD_HEIGHT * sizeof(u16));
 	consoleExpand();
 	showing = false;
 	return true;
@@ -1,5 +1,6 @@
 #include "logging.hpp"
 
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -17,6 +18,109 @@ void logIndent() { for (int i = 0; i < indent; i++) putchar('\t'); }
 
 
 
+const jerry_length_t NUMBER_PREFIX_LENGTH = 32;
+/* Copy the start of a value's string form into buffer as a c string, enough to parse a number from.
+ * buffer must hold at least NUMBER_PREFIX_LENGTH * 3 + 1 bytes.
+ */
+void toNumberPrefix(jerry_value_t value, char *buffer) {
+	jerry_value_t stringVal = jerry_value_to_string(value);
+	jerry_length_t length = jerry_get_string_length(stringVal);
+	if (length > NUMBER_PREFIX_LENGTH) length = NUMBER_PREFIX_LENGTH;
+	jerry_size_t size = jerry_substring_to_utf8_char_buffer(stringVal, 0, length, (jerry_char_t *) buffer, NUMBER_PREFIX_LENGTH * 3);
+	buffer[size] = '\0';
+	jerry_release_value(stringVal);
+}
+
+// Print a string value wrapped in a quote it doesn't contain, or in double quotes with any inside escaped.
+void printQuoted(jerry_value_t stringValue, bool allowBacktick) {
+	bool hasDouble = false, hasSingle = false, hasBacktick = false;
+	forEachStringChunk(stringValue, [&](const char *chunk, jerry_size_t size) {
+		if (memchr(chunk, '"', size)) hasDouble = true;
+		if (memchr(chunk, '\'', size)) hasSingle = true;
+		if (memchr(chunk, '`', size)) hasBacktick = true;
+	});
+	char quote = !hasDouble ? '"' : !hasSingle ? '\'' : allowBacktick && !hasBacktick ? '`' : '\0';
+	if (quote) {
+		putchar(quote);
+		printString(stringValue);
+		putchar(quote);
+		return;
+	}
+	putchar('"');
+	forEachStringChunk(stringValue, [](const char *chunk, jerry_size_t size) {
+		const char *pos = chunk, *end = chunk + size;
+		for (const char *found; (found = (const char *) memchr(pos, '"', end - pos)); pos = found + 1) {
+			fwrite(pos, 1, found - pos, stdout);
+			printf("\\\"");
+		}
+		fwrite(pos, 1, end - pos, stdout);
+	});
+	putchar('"');
+}
+
+/* Output an argument according to a format specifier.
+ * Returns false if the specifier is unknown, in which case nothing is printed.
+ */
+bool logSpecifier(char specifier, jerry_value_t arg, u16 prevColor, u16 prevBackground) {
+	if (specifier == 's') { // output next param as string
+		printValue(arg);
+	}
+	else if (specifier == 'd' || specifier == 'i') { // output next param as integer (parseInt)
+		if (jerry_value_is_symbol(arg)) printf("NaN");
+		else {
+			char string[NUMBER_PREFIX_LENGTH * 3 + 1];
+			toNumberPrefix(arg, string);
+			char *endptr = NULL;
+			s64 integer = strtoll(string, &endptr, 10);
+			if (endptr == string) printf("NaN");
+			else printf("%lli", integer);
+		}
+	}
+	else if (specifier == 'f') { // output next param as float (parseFloat)
+		if (jerry_value_is_symbol(arg)) printf("NaN");
+		else {
+			char string[NUMBER_PREFIX_LENGTH * 3 + 1];
+			toNumberPrefix(arg, string);
+			char *endptr = NULL;
+			double floatVal = strtod(string, &endptr);
+			if (endptr == string) printf("NaN");
+			else printf("%lg", floatVal);
+		}
+	}
+	else if (specifier == 'o') { // output next param with "optimally useful formatting"
+		logLiteral(arg);
+	}
+	else if (specifier == 'O') { // output next param as object
+		if (jerry_value_is_object(arg)) logObject(arg);
+		else logLiteral(arg);
+	}
+	else if (specifier == 'c') { // use next param as CSS rule
+		char *cssRule = toRawString(arg);
+		char *semicolon = strchr(cssRule, ';');
+		char *cssPos = cssRule;
+		char attribute[31] = {0};
+		char value[31] = {0};
+		int scanOutputCount = sscanf(cssPos, " %30[a-zA-Z0-9] : %30[a-zA-Z0-9#] ", attribute, value);
+		while (scanOutputCount == 2) { // found an attribute
+			if (strcmp(attribute, "color") == 0) {
+				consoleSetColor(colorParse(value, prevColor));
+			}
+			else if (strcmp(attribute, "background") == 0) {
+				consoleSetBackground(colorParse(value, prevBackground));
+			}
+			if (semicolon != NULL) {
+				cssPos = semicolon + 1;
+				semicolon = strchr(cssPos, ';');
+				scanOutputCount = sscanf(cssPos, " %30[a-zA-Z0-9] : %30[a-zA-Z0-9#] ", attribute, value);
+			}
+			else scanOutputCount = 0;
+		}
+		free(cssRule);
+	}
+	else return false;
+	return true;
+}
+
 void log(const jerry_value_t args[], jerry_length_t argCount) {
 	consolePause();
 	u32 i = 0;
@@ -24,88 +128,29 @@ void log(const jerry_value_t args[], jerry_length_t argCount) {
 		i++;
 		u16 prevColor = consoleGetColor();
 		u16 prevBackground = consoleGetBackground();
-		char *msg = rawString(args[0]);
-		char *pos = msg;
-		if (pos) while (i < argCount) {
-			char *escapedPos = strchr(pos, '%');
-			if (escapedPos == NULL) break;
-			*escapedPos = '\0';
-			printf(pos);
-			char specifier = *(escapedPos + 1);
-			if (specifier == 's') { // output next param as string
-				printValue(args[i]);
-				pos = escapedPos + 2;
-				i++;
-			}
-			else if (specifier == 'd' || specifier == 'i') { // output next param as integer (parseInt)
-				if (jerry_value_is_symbol(args[i])) printf("NaN");
-				else {
-					char *string = toRawString(args[i]);
-					char *endptr = NULL;
-					s64 integer = strtoll(string, &endptr, 10);
-					if (endptr == string) printf("NaN");
-					else printf("%lli", integer);
-					free(string);
-				}
-				pos = escapedPos + 2;
-				i++;
-			}
-			else if (specifier == 'f') { // output next param as float (parseFloat)
-				if (jerry_value_is_symbol(args[i])) printf("NaN");
-				else {
-					char *string = toRawString(args[i]);
-					char *endptr = NULL;
-					double floatVal = strtod(string, &endptr);
-					if (endptr == string) printf("NaN");
-					else printf("%lg", floatVal);
-					free(string);
-				}
-				pos = escapedPos + 2;
-				i++;
-			}
-			else if (specifier == 'o') { // output next param with "optimally useful formatting"
-				logLiteral(args[i]);
-				pos = escapedPos + 2;
-				i++;
-			}
-			else if (specifier == 'O') { // output next param as object
-				if (jerry_value_is_object(args[i])) logObject(args[i]);
-				else logLiteral(args[i]);
-				pos = escapedPos + 2;
-				i++;
-			}
-			else if (specifier == 'c') { // use next param as CSS rule
-				char *cssRule = toRawString(args[i]);
-				char *semicolon = strchr(cssRule, ';');
-				char *cssPos = cssRule;
-				char attribute[31] = {0};
-				char value[31] = {0};
-				int scanOutputCount = sscanf(cssPos, " %30[a-zA-Z0-9] : %30[a-zA-Z0-9#] ", attribute, value);
-				while (scanOutputCount == 2) { // found an attribute
-					if (strcmp(attribute, "color") == 0) {
-						consoleSetColor(colorParse(value, prevColor));
+		bool escaped = false;
+		forEachStringChunk(args[0], [&](const char *chunk, jerry_size_t size) {
+			const char *pos = chunk, *end = chunk + size;
+			for (const char *ch = chunk; ch < end; ch++) {
+				if (escaped) {
+					escaped = false;
+					if (i < argCount && logSpecifier(*ch, args[i], prevColor, prevBackground)) {
+						i++;
+						pos = ch + 1;
+						continue;
 					}
-					else if (strcmp(attribute, "background") == 0) {
-						consoleSetBackground(colorParse(value, prevBackground));
-					}
-					if (semicolon != NULL) {
-						cssPos = semicolon + 1;
-						semicolon = strchr(cssPos, ';');
-						scanOutputCount = sscanf(cssPos, " %30[a-zA-Z0-9] : %30[a-zA-Z0-9#] ", attribute, value);
-					}
-					else scanOutputCount = 0;
+					putchar('%');
+					pos = ch;
+				}
+				if (*ch == '%' && i < argCount) {
+					fwrite(pos, 1, ch - pos, stdout);
+					escaped = true;
+					pos = ch + 1;
 				}
-				free(cssRule);
-				pos = escapedPos + 2;
-				i++;
-			}
-			else {
-				putchar('%');
-				pos = escapedPos + 1;
 			}
-		}
-		printf(pos);
-		free(msg);
+			fwrite(pos, 1, end - pos, stdout);
+		});
+		if (escaped) putchar('%');
 		consoleSetColor(prevColor);
 		consoleSetBackground(prevBackground);
 		if (i < argCount) putchar(' ');
@@ -138,26 +183,10 @@ void logLiteral(jerry_value_t value, u8 level) {
 			consoleSetColor(LOGCOLOR_UNDEFINED);
 			printf("undefined");
 			break;
-		case JERRY_TYPE_STRING: {
+		case JERRY_TYPE_STRING:
 			consoleSetColor(LOGCOLOR_STRING);
-			char *string = rawString(value);
-			if (strchr(string, '"') == NULL) printf("\"%s\"", string);
-			else if (strchr(string, '\'') == NULL) printf("'%s'", string);
-			else if (strchr(string, '`') == NULL) printf("`%s`", string);
-			else {
-				putchar('"');
-				char *pos = string;
-				for (char* quote = string; (quote = strchr(quote, '"')); quote++) {
-					*quote = '\0';
-					printf("%s\\\"", pos);
-					*quote = '"';
-					pos = quote + 1;
-				}
-				printf(pos);
-				putchar('"');
-			}
-			free(string);
-		} break;
+			printQuoted(value, true);
+			break;
 		case JERRY_TYPE_SYMBOL: {
 			consoleSetColor(LOGCOLOR_STRING);
 			jerry_value_t descriptionStr = jerry_get_symbol_descriptive_string(value);
@@ -177,19 +206,21 @@ void logLiteral(jerry_value_t value, u8 level) {
 		case JERRY_TYPE_ERROR: {
 			jerry_value_t thrownVal = jerry_get_value_from_error(value, false);
 			if (isInstance(thrownVal, ref_Error)) {
-				char *message = getPropertyString(thrownVal, "message");
-				char *name = getPropertyString(thrownVal, "name");
-				printf("Uncaught %s: %s", name, message);
-				free(message);
-				free(name);
+				jerry_value_t messageVal = getProperty(thrownVal, "message");
+				jerry_value_t nameVal = getProperty(thrownVal, "name");
+				printf("Uncaught ");
+				printValue(nameVal);
+				printf(": ");
+				printValue(messageVal);
+				jerry_release_value(messageVal);
+				jerry_release_value(nameVal);
 				jerry_value_t backtraceArr = jerry_get_internal_property(thrownVal, ref_str_backtrace);
 				u32 length = jerry_get_array_length(backtraceArr);
 				for (u32 i = 0; i < length; i++) {
 					jerry_value_t traceLineStr = jerry_get_property_by_index(backtraceArr, i);
-					char *traceLine = rawString(traceLineStr);
 					for (int j = 0; j < level; j++) putchar(' ');
-					printf("\n @ %s", traceLine);
-					free(traceLine);
+					printf("\n @ ");
+					printValue(traceLineStr);
 					jerry_release_value(traceLineStr);
 				}
 				jerry_release_value(backtraceArr);
@@ -285,34 +316,19 @@ void logObject(jerry_value_t obj, u8 level) {
 		printf("{ ");
 		for (u32 i = 0; i < length; i++) {
 			jerry_value_t keyStr = jerry_get_property_by_index(keysArr, i);
-			jerry_size_t keySize;
-			char* key = rawString(keyStr, &keySize);
-			jerry_release_value(keyStr);
-			char capture[keySize + 1];
-			if (sscanf(key, "%[A-Za-z0-9]", capture) > 0 && strcmp(key, capture) == 0) {
-				printf(key);
-			}
+			bool isPlainKey = jerry_get_string_length(keyStr) > 0;
+			forEachStringChunk(keyStr, [&](const char *chunk, jerry_size_t size) {
+				for (jerry_size_t j = 0; j < size; j++) if (!isalnum((u8) chunk[j])) isPlainKey = false;
+			});
+			if (isPlainKey) printString(keyStr);
 			else {
 				u16 previousColor = consoleSetColor(LOGCOLOR_STRING);
-				if (strchr(key, '"') == NULL) printf("\"%s\"", key);
-				else if (strchr(key, '\'') == NULL) printf("'%s'", key);
-				else {
-					putchar('"');
-					char *pos = key;
-					for (char* quote = key; (quote = strchr(quote, '"')); quote++) {
-						*quote = '\0';
-						printf("%s\\\"", pos);
-						*quote = '"';
-						pos = quote + 1;
-					}
-					printf(pos);
-					putchar('"');
-				}
+				printQuoted(keyStr, false);
 				consoleSetColor(previousColor);
 			}
 			printf(": ");
-			jerry_value_t value = getProperty(obj, key);
-			free(key);
+			jerry_value_t value = jerry_get_property(obj, keyStr);
+			jerry_release_value(keyStr);
 			logLiteral(value, level + 1);
 			jerry_release_value(value);
 			if (i < length - 1) printf(", ");
@@ -344,15 +360,19 @@ jerry_length_t tableValueWidth(jerry_value_t value) {
 	}
 }
 
-void tableValuePrint(jerry_value_t value, u8 width) {
+// Pads a cell out to the width of its column, printing nothing for cells that already fill it.
+void tablePad(u16 width, u32 length) {
+	if (width > length) printf("%*s", (int) (width - length), "");
+}
+
+void tableValuePrint(jerry_value_t value, u16 width) {
 	u16 previousColor = consoleGetColor();
 	jerry_type_t type = jerry_value_get_type(value);
 	switch (type) {
-		case JERRY_TYPE_STRING: {
-			char* string = rawString(value);
-			printf("%-*s", width, string);
-			free(string);
-		} break;
+		case JERRY_TYPE_STRING:
+			printString(value);
+			tablePad(width, jerry_get_string_length(value));
+			break;
 		case JERRY_TYPE_NUMBER:
 		case JERRY_TYPE_BIGINT: {
 			consoleSetColor(LOGCOLOR_VALUE);
@@ -364,7 +384,7 @@ void tableValuePrint(jerry_value_t value, u8 width) {
 				numLen++;
 				putchar('n');
 			}
-			printf("%-*s", (int) (width - numLen), "");
+			tablePad(width, numLen);
 		} break;
 		case JERRY_TYPE_BOOLEAN:
 			consoleSetColor(LOGCOLOR_VALUE);
@@ -507,7 +527,7 @@ void logTable(const jerry_value_t args[], jerry_value_t argCount) {
 		for (u8 i = 0; i < idxColWidth; i++) putchar('-');
 		for (u32 colIdx = 0; colIdx < sharedKeyCount; colIdx++) {
 			putchar('+');
-			for (u8 i = 0; i < colWidths[colIdx]; i++) putchar('-');
+			for (u16 i = 0; i < colWidths[colIdx]; i++) putchar('-');
 		}
 		putchar('\n');
 		// print for each row in the object
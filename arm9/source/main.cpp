@@ -88,12 +88,14 @@ int main(int argc, char **argv) {
 	clearTimeouts();
 	releaseReferences();
 	jerry_cleanup();
+	consoleSetLogFile(NULL);
 
 	// exit
 	if (!userClosed) while (true) {
 		swiWaitForVBlank();
 		scanKeys();
 		if (keysDown() & KEY_START) break;
+		consoleUpdate();
 	}
 	return 0;
 }
\ No newline at end of file
@@ -1,8 +1,18 @@
-#include <nds/arm9/sprite.h>
+#include "sprite.hpp"
+
+#include <nds/arm9/cache.h>
 #include <nds/arm9/trig_lut.h>
+#include <nds/dma.h>
+#include <nds/interrupts.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <vector>
 
 #include "event.hpp"
+#include "hblank.hpp"
+#include "util/compression.hpp"
 #include "util/helpers.hpp"
 
 
@@ -12,454 +22,960 @@ JS_class ref_PalettedSprite;
 JS_class ref_BitmapSprite;
 JS_class ref_SpriteGraphic;
 JS_class ref_SpriteAffineMatrix;
+JS_class ref_SpriteAnimation;
 
-const char WAS_REMOVED[] = "Using a previously removed object.";
-#define NOT_REMOVED(obj) if (testInternal(obj, ref_str_removed)) return TypeError(WAS_REMOVED)
-
-#define BOUND(n, min, max) n < min ? min : n > max ? max : n
+#define NOT_REMOVED(native) if (native->removed) return TypeError(WAS_REMOVED)
 
 bool spriteUpdateMain = false;
 bool spriteUpdateSub = false;
-u8 spriteUsage[SPRITE_COUNT] = {0};
-#define USAGE_SPRITE_MAIN BIT(0)
-#define USAGE_MATRIX_MAIN BIT(1)
-#define USAGE_SPRITE_SUB BIT(2)
-#define USAGE_MATRIX_SUB BIT(3)
-#define SPRITE_ENGINE(obj) (testInternal(obj, ref_str_main) ? &oamMain : &oamSub)
-#define SPRITE_ENTRY(obj) (SPRITE_ENGINE(obj)->oamMemory + getID(obj))
+NativeSpriteEngine *spriteEngines[2] = {NULL, NULL};
+/* Scripts write to the libnds shadow OAM. Committing copies a finished frame of it here,
+ * which is only copied to OAM during vblank so sprites are never updated mid-frame.
+ */
+alignas(4) SpriteEntry committedOAM[2][SPRITE_COUNT];
+alignas(4) SpriteEntry sortedOAM[SPRITE_COUNT];
+volatile bool commitPending[2] = {false, false};
+#define VIRTUAL_SPRITE_COUNT 512
+bool spriteInUse[2][VIRTUAL_SPRITE_COUNT] = {0};
+u8 spriteUsage[MATRIX_COUNT] = {0};
+// Sprites and matrices in use by slot, so they can be reached by ID
+NativeSprite *spriteSlots[2][VIRTUAL_SPRITE_COUNT] = {0};
+jerry_value_t matrixSlots[2][MATRIX_COUNT] = {0};
+#define USAGE_MATRIX_MAIN BIT(0)
+#define USAGE_MATRIX_SUB BIT(1)
+#define SPRITE_ENGINE(native) (native->main ? &oamMain : &oamSub)
+#define SPRITE_ENTRY(native) (spriteTables[ENGINE_INDEX(native)] + native->id)
+#define SPRITE_MATRIX(native) (SPRITE_ENGINE(native)->oamRotationMemory + native->id)
+#define ENGINE_INDEX(native) (native->main ? 0 : 1)
+#define SPRITE_FORMAT(bpp) (bpp == 4 ? SpriteColorFormat_16Color : bpp == 8 ? SpriteColorFormat_256Color : SpriteColorFormat_Bmp)
+
+/* When multiplexing, scripts write to a table of virtual sprites instead of the shadow OAM.
+ * Committing sorts them by Y into the 128 OAM entries for the top of the screen, plus writes that reuse
+ * each entry further down once its previous sprite is done drawing, which are made from the HBlank interrupt.
+ */
+struct MultiplexWrite {
+	u8 line; // made during the hblank of this line
+	u8 slot;
+	SpriteEntry entry; // attribute 3 isn't written, OAM keeps matrix parameters there
+};
+struct Multiplexer {
+	volatile bool enabled;
+	SpriteEntry table[VIRTUAL_SPRITE_COUNT];
+	// double buffered, the vblank interrupt swaps in a commit when it's pending
+	alignas(4) SpriteEntry initial[2][SPRITE_COUNT];
+	MultiplexWrite writes[2][VIRTUAL_SPRITE_COUNT - SPRITE_COUNT];
+	u16 writeCount[2];
+	volatile u8 active;
+	volatile u16 next;
+	u16 dropped; // visible sprites left out of the last commit, for lack of a free entry before the bottom of the screen
+};
+Multiplexer multiplexers[2];
+// where sprite entries are written, either the shadow OAM or the virtual sprite table
+SpriteEntry *spriteTables[2];
+#define SPRITE_LIMIT(idx) (multiplexers[idx].enabled ? VIRTUAL_SPRITE_COUNT : SPRITE_COUNT)
 
-inline int getID(jerry_value_t obj) {
-	jerry_value_t idNum = getInternal(obj, "id");
-	int id = jerry_value_as_integer(idNum);
-	jerry_release_value(idNum);
-	return id;
+// libnds sprite functions are given a view of OAM starting at the entry, so they can reach virtual sprites too.
+OamState spriteView(bool main, int id) {
+	OamState view = *(main ? &oamMain : &oamSub);
+	view.oamMemory = spriteTables[main ? 0 : 1] + id;
+	return view;
 }
 
-void spriteUpdate() {
-	if (spriteUpdateMain) oamUpdate(&oamMain);
-	if (spriteUpdateSub) oamUpdate(&oamSub);
+u8 spriteSizeWidth(SpriteSize size) {
+	if (size == SpriteSize_8x8 || size == SpriteSize_8x16 || size == SpriteSize_8x32) return 8;
+	if (size == SpriteSize_16x8 || size == SpriteSize_16x16 || size == SpriteSize_16x32) return 16;
+	if (size == SpriteSize_32x8 || size == SpriteSize_32x16 || size == SpriteSize_32x32 || size == SpriteSize_32x64) return 32;
+	return 64;
+}
+u8 spriteSizeHeight(SpriteSize size) {
+	if (size == SpriteSize_8x8 || size == SpriteSize_16x8 || size == SpriteSize_32x8) return 8;
+	if (size == SpriteSize_8x16 || size == SpriteSize_16x16 || size == SpriteSize_32x16) return 16;
+	if (size == SpriteSize_8x32 || size == SpriteSize_16x32 || size == SpriteSize_32x32 || size == SpriteSize_64x32) return 32;
+	return 64;
 }
 
+/* Sprite graphics memory is allocated in blocks of the engine's boundary size,
+ * so blocks can be moved together (and OAM pointed at their new spot) when memory gets fragmented.
+ * 2D mappings lay graphics out in a grid, and are left to the libnds allocator.
+ */
+struct GfxBlock {
+	u16 offset; // in boundary units, same as the OAM gfx index
+	u16 size;
+	NativeSpriteGraphic *owner; // NULL if its object was collected without being removed
+};
+struct GfxAllocator {
+	bool linear;
+	u32 boundary;
+	u32 capacity;
+	std::vector<GfxBlock> blocks; // sorted by offset
+};
+GfxAllocator gfxAllocators[2];
 
+jerry_value_t createGraphicData(u16 *gfx, u32 byteSize) {
+	jerry_value_t arrayBuffer = jerry_create_arraybuffer_external(byteSize, (u8 *) gfx, [](void * _){});
+	jerry_value_t typedArray = jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8, arrayBuffer);
+	jerry_release_value(arrayBuffer);
+	return typedArray;
+}
+// Detaches a graphic's data, so it can't be used to write to memory that no longer belongs to it.
+void detachGraphicData(NativeSpriteGraphic *graphic) {
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(graphic->data, &byteOffset, &byteLength);
+	jerry_release_value(jerry_detach_arraybuffer(arrayBuffer));
+	jerry_release_value(arrayBuffer);
+}
 
-FUNCTION(Sprite_set_x) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENTRY(thisValue)->x = jerry_value_as_uint32(args[0]);
-	return JS_UNDEFINED;
+u16 *gfxBase(int idx) {
+	return idx == 0 ? SPRITE_GFX : SPRITE_GFX_SUB;
 }
-FUNCTION(Sprite_get_x) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(SPRITE_ENTRY(thisValue)->x);
+
+// Returns the index of the block allocated in the first gap that fits, or -1 if none does.
+int gfxFindSpace(GfxAllocator &allocator, u16 units) {
+	u32 next = 0;
+	u32 i = 0;
+	for (; i < allocator.blocks.size(); i++) {
+		if (allocator.blocks[i].offset - next >= units) break;
+		next = allocator.blocks[i].offset + allocator.blocks[i].size;
+	}
+	if (next + units > allocator.capacity) return -1;
+	allocator.blocks.insert(allocator.blocks.begin() + i, {.offset = (u16) next, .size = units, .owner = NULL});
+	return i;
 }
 
-FUNCTION(Sprite_set_y) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENTRY(thisValue)->y = jerry_value_as_uint32(args[0]);
-	return JS_UNDEFINED;
+// Moves every block down to close the gaps between them, then points sprites and graphics at the new locations.
+void gfxDefragment(int idx) {
+	GfxAllocator &allocator = gfxAllocators[idx];
+	std::vector<u16> oldOffsets(allocator.blocks.size());
+	u32 next = 0;
+	for (u32 i = 0; i < allocator.blocks.size(); i++) {
+		GfxBlock &block = allocator.blocks[i];
+		oldOffsets[i] = block.offset;
+		if (block.offset != next) {
+			// ascending copies are safe when moving down, even if the old and new spots overlap
+			dmaCopy(gfxBase(idx) + block.offset * allocator.boundary / 2, gfxBase(idx) + next * allocator.boundary / 2, block.size * allocator.boundary);
+			block.offset = next;
+			if (block.owner != NULL) {
+				block.owner->gfx = gfxBase(idx) + next * allocator.boundary / 2;
+				detachGraphicData(block.owner);
+				jerry_release_value(block.owner->data);
+				block.owner->data = createGraphicData(block.owner->gfx, block.owner->byteSize);
+			}
+		}
+		next += block.size;
+	}
+
+	auto patch = [&](SpriteEntry &entry) {
+		for (u32 j = 0; j < allocator.blocks.size(); j++) {
+			if (entry.gfxIndex == oldOffsets[j]) {
+				entry.gfxIndex = allocator.blocks[j].offset;
+				break;
+			}
+		}
+	};
+	u32 oldIME = enterCriticalSection();
+	for (int i = 0; i < SPRITE_LIMIT(idx); i++) patch(spriteTables[idx][i]);
+	Multiplexer &mux = multiplexers[idx];
+	if (mux.enabled) {
+		for (int b = 0; b < 2; b++) {
+			for (SpriteEntry &entry : mux.initial[b]) patch(entry);
+			for (u32 i = 0; i < mux.writeCount[b]; i++) patch(mux.writes[b][i].entry);
+		}
+	}
+	else {
+		for (SpriteEntry &entry : committedOAM[idx]) patch(entry);
+		commitPending[idx] = true;
+	}
+	leaveCriticalSection(oldIME);
 }
-FUNCTION(Sprite_get_y) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(SPRITE_ENTRY(thisValue)->y);
+
+void gfxFree(NativeSpriteGraphic *graphic) {
+	int idx = ENGINE_INDEX(graphic);
+	GfxAllocator &allocator = gfxAllocators[idx];
+	if (!allocator.linear) {
+		oamFreeGfx(SPRITE_ENGINE(graphic), graphic->gfx);
+		return;
+	}
+	for (auto it = allocator.blocks.begin(); it != allocator.blocks.end(); it++) {
+		if (it->owner == graphic) {
+			allocator.blocks.erase(it);
+			return;
+		}
+	}
 }
 
-FUNCTION(Sprite_setPosition) {
-	NOT_REMOVED(thisValue);
-	REQUIRE(2);
-	oamSetXY(SPRITE_ENGINE(thisValue), getID(thisValue), jerry_value_as_int32(args[0]), jerry_value_as_int32(args[1]));
-	return JS_UNDEFINED;
+NativeSpriteGraphic::~NativeSpriteGraphic() {
+	// the graphic may still be displayed by sprites that weren't removed, so its memory stays allocated
+	for (GfxBlock &block : gfxAllocators[ENGINE_INDEX(this)].blocks) {
+		if (block.owner == this) block.owner = NULL;
+	}
+	jerry_release_value(data);
 }
 
-FUNCTION(Sprite_set_gfx) {
-	NOT_REMOVED(thisValue);
-	EXPECT(isInstance(args[0], ref_SpriteGraphic), SpriteGraphic);
-	NOT_REMOVED(args[0]);
-	OamState *engine = SPRITE_ENGINE(thisValue);
-	if (SPRITE_ENGINE(args[0]) != engine) return TypeError("Given SpriteGraphic was from the wrong engine.");
-	
-	jerry_value_t sizeNum = getInternal(args[0], "size");
-	jerry_value_t bppNum = getInternal(args[0], "colorFormat");
-	SpriteSize size = (SpriteSize) jerry_value_as_uint32(sizeNum);
-	int bpp = jerry_value_as_int32(bppNum);
-	jerry_release_value(sizeNum);
-	jerry_release_value(bppNum);
-	jerry_value_t typedArray = getInternal(args[0], "data");
-	jerry_length_t byteOffset, arrayBufferLen;
-	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(typedArray, &byteOffset, &arrayBufferLen);
-	u8 *gfxData = jerry_get_arraybuffer_pointer(arrayBuffer);
-	jerry_release_value(arrayBuffer);
-	jerry_release_value(typedArray);
-
-	oamSetGfx(
-		engine,
-		getID(thisValue),
-		size,
-		bpp == 4 ? SpriteColorFormat_16Color : bpp == 8 ? SpriteColorFormat_256Color : SpriteColorFormat_Bmp,
-		gfxData
-	);
+NativeSpriteAnimation::~NativeSpriteAnimation() {
+	for (AnimationFrame &frame : frames) jerry_release_value(frame.graphicObj);
+}
 
-	setInternal(thisValue, "gfx", args[0]);
-	return JS_UNDEFINED;
+NativeSprite::~NativeSprite() {
+	delete motion;
+	if (spriteSlots[ENGINE_INDEX(this)][id] == this) spriteSlots[ENGINE_INDEX(this)][id] = NULL;
 }
-FUNCTION(Sprite_get_gfx) {
-	NOT_REMOVED(thisValue);
-	return getInternal(thisValue, "gfx");
+
+bool matrixInUse(bool main, int id) {
+	return id >= 0 && id < MATRIX_COUNT && (spriteUsage[id] & (main ? USAGE_MATRIX_MAIN : USAGE_MATRIX_SUB));
 }
 
-FUNCTION(Sprite_set_palette) {
-	NOT_REMOVED(thisValue);
-	int palette = jerry_value_as_int32(args[0]);
-	SPRITE_ENTRY(thisValue)->palette = BOUND(palette, 0, 15);
-	return JS_UNDEFINED;
+// Applies the hidden state and affine matrix of a sprite to its OAM entry.
+void spriteApplyAffine(NativeSprite *sprite, SpriteEntry *entry, bool hidden) {
+	if (sprite->affineID == -1 || hidden) {
+		entry->isRotateScale = false;
+		entry->isHidden = hidden;
+		entry->hFlip = sprite->flipH;
+		entry->vFlip = sprite->flipV;
+	}
+	else {
+		entry->isRotateScale = true;
+		entry->rotationIndex = sprite->affineID;
+		entry->isSizeDouble = sprite->sizeDouble;
+	}
+}
+
+u8 spriteEntryWidth(const SpriteEntry &entry) {
+	static const u8 widths[4][4] = {{8, 16, 32, 64}, {16, 32, 32, 64}, {8, 8, 16, 32}, {0, 0, 0, 0}};
+	u8 width = widths[entry.shape][entry.size];
+	return entry.isRotateScale && entry.isSizeDouble ? width * 2 : width;
 }
-FUNCTION(Sprite_get_palette) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(SPRITE_ENTRY(thisValue)->palette);
+u8 spriteEntryHeight(const SpriteEntry &entry) {
+	static const u8 heights[4][4] = {{8, 16, 32, 64}, {8, 8, 16, 32}, {16, 32, 32, 64}, {0, 0, 0, 0}};
+	u8 height = heights[entry.shape][entry.size];
+	return entry.isRotateScale && entry.isSizeDouble ? height * 2 : height;
 }
 
-FUNCTION(Sprite_set_priority) {
-	NOT_REMOVED(thisValue);
-	int priority = jerry_value_as_int32(args[0]);
-	oamSetPriority(SPRITE_ENGINE(thisValue), getID(thisValue), BOUND(priority, 0, 3));
-	return JS_UNDEFINED;
+inline void copyAttributes(vu16 *dest, const SpriteEntry &source) {
+	const u16 *attributes = (const u16 *) &source;
+	dest[0] = attributes[0];
+	dest[1] = attributes[1];
+	dest[2] = attributes[2];
 }
-FUNCTION(Sprite_get_priority) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(SPRITE_ENTRY(thisValue)->priority);
+
+inline void hideEntry(SpriteEntry &entry) {
+	entry.isRotateScale = false;
+	entry.isHidden = true;
 }
 
-FUNCTION(Sprite_set_hidden) {
-	NOT_REMOVED(thisValue);
-	SpriteEntry *sprite = SPRITE_ENTRY(thisValue);
-	if (jerry_get_boolean_value(args[0])) { // hide
-		if (sprite->isRotateScale) {
-			// detach affine index so the sprite can be hidden
-			sprite->isRotateScale = false;
-			sprite->isSizeDouble = false;
+// Sorts visible virtual sprites by their top line, and fills the inactive buffers with where each one goes.
+void multiplexBuild(int idx, const SpriteEntry *shadow) {
+	Multiplexer &mux = multiplexers[idx];
+	u8 buffer = mux.active ^ 1;
+	static u16 order[VIRTUAL_SPRITE_COUNT];
+	static s16 tops[VIRTUAL_SPRITE_COUNT];
+	u32 count = 0;
+	for (u32 i = 0; i < VIRTUAL_SPRITE_COUNT; i++) {
+		const SpriteEntry &entry = mux.table[i];
+		if (!spriteInUse[idx][i] || (entry.isHidden && !entry.isRotateScale)) continue;
+		// Y wraps around, so sprites near the bottom of the range are partly above the screen
+		s16 top = entry.y < SCREEN_HEIGHT ? entry.y : entry.y - 256;
+		if (top + spriteEntryHeight(entry) <= 0) continue;
+		tops[i] = top;
+		order[count++] = i;
+	}
+	std::stable_sort(order, order + count, [](u16 a, u16 b) { return tops[a] < tops[b]; });
+
+	SpriteEntry *initial = mux.initial[buffer];
+	memcpy(initial, shadow, sizeof(mux.initial[buffer]));
+	MultiplexWrite *writes = mux.writes[buffer];
+	u16 writeCount = 0;
+	/* Each sprite past the first 128 reuses whichever entry frees up first, from a min-heap of the bottoms of their sprites.
+	 * A sprite is read from OAM during the line above the one it's drawn on, and an hblank write is read during the next line,
+	 * so an entry can be written during the hblank two lines above its sprite's bottom, and its next sprite shows from
+	 * its top if written two lines above that. Later sprites in a band that's too crowded start late.
+	 */
+	static std::pair<s16, u8> slotBottoms[SPRITE_COUNT];
+	auto freesLater = [](const std::pair<s16, u8> &a, const std::pair<s16, u8> &b) { return a.first > b.first; };
+	s16 slotLine[SPRITE_COUNT];
+	u32 slotCount = 0;
+	mux.dropped = 0;
+	for (u32 k = 0; k < count; k++) {
+		const SpriteEntry &entry = mux.table[order[k]];
+		u8 slot;
+		if (k < SPRITE_COUNT) {
+			slot = k;
+			copyAttributes((vu16 *) (initial + slot), entry);
+			slotLine[slot] = 0;
 		}
-		sprite->isHidden = true;
-	}
-	else if (!sprite->isRotateScale) { // unhide (if isRotateScale is true, then it is already visible)
-		sprite->isHidden = false;
-		jerry_value_t affineObj = getInternal(thisValue, "affine");
-		if (!jerry_value_is_null(affineObj)) {
-			// reattach affine index and reset sizeDouble value
-			sprite->rotationIndex = getID(affineObj);
-			sprite->isSizeDouble = testInternal(thisValue, "sizeDouble");
-			sprite->isRotateScale = true;
+		else {
+			std::pop_heap(slotBottoms, slotBottoms + slotCount, freesLater);
+			slot = slotBottoms[--slotCount].second;
+			s16 line = std::max<s16>(slotBottoms[slotCount].first - 2, slotLine[slot]);
+			if (line >= SCREEN_HEIGHT) {
+				// every entry is taken to the bottom of the screen, and sprites further down only start later
+				mux.dropped = count - k;
+				break;
+			}
+			writes[writeCount++] = {.line = (u8) line, .slot = slot, .entry = entry};
+			slotLine[slot] = line;
 		}
-		jerry_release_value(affineObj);
+		slotBottoms[slotCount++] = {(s16) (tops[order[k]] + spriteEntryHeight(entry)), slot};
+		std::push_heap(slotBottoms, slotBottoms + slotCount, freesLater);
 	}
-	return JS_UNDEFINED;
+	for (u32 slot = count; slot < SPRITE_COUNT; slot++) hideEntry(initial[slot]);
+	std::stable_sort(writes, writes + writeCount, [](const MultiplexWrite &a, const MultiplexWrite &b) { return a.line < b.line; });
+	mux.writeCount[buffer] = writeCount;
 }
-FUNCTION(Sprite_get_hidden) {
-	NOT_REMOVED(thisValue);
-	SpriteEntry *sprite = SPRITE_ENTRY(thisValue);
-	return jerry_create_boolean(sprite->isHidden && !sprite->isRotateScale);
+
+/* Sprites are drawn front to back by this key when sorted, then by ID.
+ * Unsorted and multiplexed sprites stay in ID order, so only their priority counts, which touches go by too.
+ */
+s32 spriteDepthKey(int idx, const SpriteEntry &entry, NativeSprite *sprite) {
+	SpriteSort sort = multiplexers[idx].enabled ? SORT_NONE : spriteEngines[idx]->sort;
+	s32 key = 0;
+	if (sort == SORT_Y) key = -((entry.y < SCREEN_HEIGHT ? entry.y : entry.y - 256) + spriteEntryHeight(entry));
+	else if (sort == SORT_Z && sprite != NULL) key = -sprite->z;
+	return (s32) entry.priority * 0x20000 + key;
 }
 
-FUNCTION(Sprite_set_flipH) {
-	NOT_REMOVED(thisValue);
-	bool set = jerry_get_boolean_value(args[0]);
-	setInternal(thisValue, "flipH", jerry_create_boolean(set));
-	SpriteEntry *sprite = SPRITE_ENTRY(thisValue);
-	if (!sprite->isRotateScale) sprite->hFlip = set;
-	return JS_UNDEFINED;
+/* Reorders the shadow OAM into sortedOAM by the engine's sort mode.
+ * Only sprite attributes move, attribute 3 holds matrix parameters and stays in place.
+ */
+void spriteSort(int idx, const SpriteEntry *shadow) {
+	static u16 order[SPRITE_COUNT];
+	static s32 keys[SPRITE_COUNT];
+	for (int i = 0; i < SPRITE_COUNT; i++) {
+		order[i] = i;
+		keys[i] = spriteDepthKey(idx, shadow[i], spriteSlots[idx][i]);
+	}
+	std::stable_sort(order, order + SPRITE_COUNT, [](u16 a, u16 b) { return keys[a] < keys[b]; });
+	for (int i = 0; i < SPRITE_COUNT; i++) {
+		copyAttributes((vu16 *) (sortedOAM + i), shadow[order[i]]);
+		sortedOAM[i].attribute3 = shadow[i].attribute3;
+	}
 }
-FUNCTION(Sprite_get_flipH) {
-	NOT_REMOVED(thisValue);
-	return getInternal(thisValue, "flipH");
+
+void spriteCommit(bool main) {
+	if (!(main ? spriteUpdateMain : spriteUpdateSub)) return;
+	int idx = main ? 0 : 1;
+	const SpriteEntry *shadow = (main ? &oamMain : &oamSub)->oamMemory;
+	if (multiplexers[idx].enabled) {
+		// building takes a while, so rather than blocking interrupts, the buffers being built can't be swapped in meanwhile
+		commitPending[idx] = false;
+		multiplexBuild(idx, shadow);
+		commitPending[idx] = true;
+		return;
+	}
+	if (spriteEngines[idx]->sort != SORT_NONE) {
+		spriteSort(idx, shadow);
+		shadow = sortedOAM;
+	}
+	u32 oldIME = enterCriticalSection();
+	memcpy(committedOAM[idx], shadow, sizeof(committedOAM[idx]));
+	commitPending[idx] = true;
+	leaveCriticalSection(oldIME);
 }
 
-FUNCTION(Sprite_set_flipV) {
-	NOT_REMOVED(thisValue);
-	bool set = jerry_get_boolean_value(args[0]);
-	setInternal(thisValue, "flipV", jerry_create_boolean(set));
-	SpriteEntry *sprite = SPRITE_ENTRY(thisValue);
-	if (!sprite->isRotateScale) sprite->vFlip = set;
-	return JS_UNDEFINED;
+void spriteVBlank() {
+	for (int idx = 0; idx < 2; idx++) {
+		Multiplexer &mux = multiplexers[idx];
+		const u32 *source;
+		if (mux.enabled) {
+			// the HBlank writes changed OAM over the last frame, so the top of the screen is restored every time
+			if (commitPending[idx]) mux.active ^= 1;
+			mux.next = 0;
+			source = (const u32 *) mux.initial[mux.active];
+		}
+		else if (commitPending[idx]) source = (const u32 *) committedOAM[idx];
+		else continue;
+		// OAM can't be written a byte at a time
+		vu32 *dest = (vu32 *) (idx == 0 ? OAM : OAM_SUB);
+		for (u32 i = 0; i < SPRITE_COUNT * sizeof(SpriteEntry) / 4; i++) dest[i] = source[i];
+		commitPending[idx] = false;
+	}
 }
-FUNCTION(Sprite_get_flipV) {
-	NOT_REMOVED(thisValue);
-	return getInternal(thisValue, "flipV");
+
+void spriteHBlank() {
+	u16 line = REG_VCOUNT;
+	if (line >= SCREEN_HEIGHT) return;
+	for (int idx = 0; idx < 2; idx++) {
+		Multiplexer &mux = multiplexers[idx];
+		if (!mux.enabled) continue;
+		const MultiplexWrite *writes = mux.writes[mux.active];
+		u16 writeCount = mux.writeCount[mux.active];
+		vu16 *oam = (vu16 *) (idx == 0 ? OAM : OAM_SUB);
+		while (mux.next < writeCount && writes[mux.next].line <= line) {
+			copyAttributes(oam + writes[mux.next].slot * 4, writes[mux.next].entry);
+			mux.next++;
+		}
+	}
 }
 
-FUNCTION(Sprite_set_affine) {
-	NOT_REMOVED(thisValue);
-	OamState *engine = SPRITE_ENGINE(thisValue);
-	SpriteEntry *sprite = engine->oamMemory + getID(thisValue);
-	if (jerry_value_is_null(args[0])) {
-		if (sprite->isRotateScale) {
-			sprite->isRotateScale = false;
-			sprite->isSizeDouble = false;
+void multiplexSetEnabled(int idx, bool enabled) {
+	Multiplexer &mux = multiplexers[idx];
+	mux.enabled = false;
+	if (enabled) {
+		for (SpriteEntry &entry : mux.table) hideEntry(entry);
+		for (int b = 0; b < 2; b++) {
+			for (SpriteEntry &entry : mux.initial[b]) hideEntry(entry);
+			mux.writeCount[b] = 0;
 		}
-		sprite->hFlip = testInternal(thisValue, "flipH");
-		sprite->vFlip = testInternal(thisValue, "flipV");
+		mux.next = 0;
+	}
+	mux.dropped = 0;
+	spriteTables[idx] = enabled ? mux.table : (idx == 0 ? &oamMain : &oamSub)->oamMemory;
+	mux.enabled = enabled;
+	// OAM is only free to write during hblank with this set, at the cost of fewer sprite pixels per line
+	if (idx == 0) REG_DISPCNT = enabled ? REG_DISPCNT | DISPLAY_SPR_HBLANK : REG_DISPCNT & ~DISPLAY_SPR_HBLANK;
+	else REG_DISPCNT_SUB = enabled ? REG_DISPCNT_SUB | DISPLAY_SPR_HBLANK : REG_DISPCNT_SUB & ~DISPLAY_SPR_HBLANK;
+	hblankInterruptUpdate();
+}
+
+bool spriteMultiplexing() {
+	return multiplexers[0].enabled || multiplexers[1].enabled;
+}
+
+bool spriteGetBounds(NativeSprite *sprite, s16 *x, s16 *y, u16 *width, u16 *height) {
+	if (sprite->removed) return false;
+	const SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	if (entry->isHidden && !entry->isRotateScale) return false;
+	// positions wrap around, so the far ends of their ranges are left of and above the screen
+	*x = entry->x < 256 ? entry->x : entry->x - 512;
+	*y = entry->y < SCREEN_HEIGHT ? entry->y : entry->y - 256;
+	*width = spriteEntryWidth(*entry);
+	*height = spriteEntryHeight(*entry);
+	return true;
+}
+
+// Whether the pixel of a graphic at x, y is opaque. Only 1D-mapped graphics can be tested, others are treated as opaque.
+bool graphicPixelOpaque(NativeSpriteGraphic *graphic, u32 x, u32 y) {
+	if (!gfxAllocators[ENGINE_INDEX(graphic)].linear) return true;
+	if (graphic->bpp == 16) return graphic->gfx[x + y * graphic->width] & BIT(15);
+	u32 index = ((y / 8) * (graphic->width / 8) + x / 8) * 64 + (y % 8) * 8 + x % 8;
+	const u8 *pixels = (const u8 *) graphic->gfx;
+	if (graphic->bpp == 4) return (pixels[index / 2] >> (index % 2) * 4) & 0xF;
+	return pixels[index];
+}
+
+bool spriteHit(NativeSprite *sprite, NativeSpriteGraphic *graphic, int x, int y) {
+	s16 left, top;
+	u16 width, height;
+	if (!spriteGetBounds(sprite, &left, &top, &width, &height)) return false;
+	if (x < left || y < top || x >= left + width || y >= top + height) return false;
+	const SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	s32 gx, gy;
+	if (entry->isRotateScale) {
+		// the matrix maps from screen space around the center of the sprite to graphic space around its center
+		const SpriteRotation *matrix = (sprite->main ? &oamMain : &oamSub)->oamRotationMemory + entry->rotationIndex;
+		s32 dx = x - (left + width / 2), dy = y - (top + height / 2);
+		gx = ((matrix->hdx * dx + matrix->vdx * dy) >> 8) + graphic->width / 2;
+		gy = ((matrix->hdy * dx + matrix->vdy * dy) >> 8) + graphic->height / 2;
+		if (gx < 0 || gy < 0 || gx >= graphic->width || gy >= graphic->height) return false;
 	}
 	else {
-		EXPECT(isInstance(args[0], ref_SpriteAffineMatrix), SpriteAffineMatrix);
-		NOT_REMOVED(args[0]);
-		if (SPRITE_ENGINE(args[0]) != engine) return TypeError("Given SpriteAffineMatrix was from the wrong engine.");
-		if (sprite->isRotateScale || !sprite->isHidden) {
-			sprite->rotationIndex = getID(args[0]);
-			sprite->isSizeDouble = testInternal(thisValue, "sizeDouble");
-			sprite->isRotateScale = true;
+		gx = entry->hFlip ? left + width - 1 - x : x - left;
+		gy = entry->vFlip ? top + height - 1 - y : y - top;
+	}
+	return !graphic->touchMask || graphic->removed || graphicPixelOpaque(graphic, gx, gy);
+}
+
+NativeSprite *spriteTouchTarget(int x, int y) {
+	int idx = REG_POWERCNT & POWER_SWAP_LCDS ? 1 : 0;
+	if (!(idx == 0 ? spriteUpdateMain : spriteUpdateSub)) return NULL;
+	NativeSprite *target = NULL;
+	s32 targetKey = 0;
+	for (NativeSprite *sprite : spriteSlots[idx]) {
+		if (sprite == NULL) continue;
+		NativeSpriteGraphic *graphic = sprite->animation != NULL ? sprite->animation->frames[sprite->animationFrame].graphic : sprite->graphic;
+		if (!spriteHit(sprite, graphic, x, y)) continue;
+		s32 key = spriteDepthKey(idx, *SPRITE_ENTRY(sprite), sprite);
+		// slots are in ID order, so a later sprite is only in front with a lower key
+		if (target != NULL && key >= targetKey) continue;
+		if (!hasEventListeners(sprite->object, "touchstart") && !hasEventListeners(sprite->object, "touchmove") && !hasEventListeners(sprite->object, "touchend")) continue;
+		target = sprite;
+		targetKey = key;
+	}
+	return target;
+}
+
+void spriteShowFrame(NativeSprite *sprite, u16 frame) {
+	AnimationFrame &animationFrame = sprite->animation->frames[frame];
+	sprite->animationFrame = frame;
+	sprite->frameTime = animationFrame.duration;
+	NativeSpriteGraphic *graphic = animationFrame.graphic;
+	if (graphic->removed) return;
+	OamState view = spriteView(sprite->main, sprite->id);
+	oamSetGfx(&view, 0, graphic->size, SPRITE_FORMAT(graphic->bpp), graphic->gfx);
+}
+
+void spriteAnimate(NativeSprite *sprite) {
+	if (--sprite->frameTime > 0) return;
+	NativeSpriteAnimation *animation = sprite->animation;
+	u16 frame = sprite->animationFrame, last = animation->frames.size() - 1;
+	if (animation->mode == ANIMATION_PINGPONG && last > 0) {
+		if (frame == last) sprite->animationReverse = true;
+		else if (frame == 0) sprite->animationReverse = false;
+		frame = sprite->animationReverse ? frame - 1 : frame + 1;
+	}
+	else if (frame < last) frame++;
+	else if (animation->mode == ANIMATION_LOOP) frame = 0;
+	else {
+		sprite->animationPlaying = false;
+		jerry_value_t event = createEvent("animationend", false);
+		queueEvent(sprite->object, event);
+		jerry_release_value(event);
+		return;
+	}
+	spriteShowFrame(sprite, frame);
+}
+
+SpriteMotion *spriteMotion(NativeSprite *sprite) {
+	if (sprite->motion == NULL) {
+		const SpriteEntry *entry = SPRITE_ENTRY(sprite);
+		sprite->motion = new SpriteMotion{
+			.x = (entry->x < 256 ? entry->x : entry->x - 512) << 8,
+			.y = (entry->y < SCREEN_HEIGHT ? entry->y : entry->y - 256) << 8,
+			.vx = 0, .vy = 0, .ax = 0, .ay = 0, .friction = 0,
+			.bounds = BOUNDS_NONE, .left = 0, .top = 0, .right = 0, .bottom = 0
+		};
+	}
+	return sprite->motion;
+}
+
+// Keeps one axis of a sprite within [min, max - size].
+void spriteBoundAxis(MotionBounds bounds, s32 &position, s32 &velocity, s32 min, s32 max, s32 size) {
+	min <<= 8;
+	max <<= 8;
+	size <<= 8;
+	if (bounds == BOUNDS_WRAP) {
+		if (position >= max) position -= max - min + size;
+		else if (position + size <= min) position += max - min + size;
+		return;
+	}
+	if (position < min) position = min;
+	else if (position > max - size) position = max - size;
+	else return;
+	velocity = bounds == BOUNDS_BOUNCE ? -velocity : 0;
+}
+
+void spriteMove(NativeSprite *sprite) {
+	SpriteMotion *motion = sprite->motion;
+	motion->vx += motion->ax;
+	motion->vy += motion->ay;
+	motion->vx -= motion->vx * motion->friction >> 8;
+	motion->vy -= motion->vy * motion->friction >> 8;
+	motion->x += motion->vx;
+	motion->y += motion->vy;
+	SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	if (motion->bounds != BOUNDS_NONE) {
+		spriteBoundAxis(motion->bounds, motion->x, motion->vx, motion->left, motion->right, spriteEntryWidth(*entry));
+		spriteBoundAxis(motion->bounds, motion->y, motion->vy, motion->top, motion->bottom, spriteEntryHeight(*entry));
+	}
+	entry->x = motion->x >> 8;
+	entry->y = motion->y >> 8;
+}
+
+void spriteUpdate() {
+	for (int idx = 0; idx < 2; idx++) {
+		for (NativeSprite *sprite : spriteSlots[idx]) {
+			if (sprite == NULL) continue;
+			if (sprite->animation != NULL && sprite->animationPlaying) spriteAnimate(sprite);
+			if (sprite->motion != NULL) spriteMove(sprite);
 		}
 	}
-	setInternal(thisValue, "affine", args[0]);
-	return JS_UNDEFINED;
+	if (spriteEngines[0]->autoCommit) spriteCommit(true);
+	if (spriteEngines[1]->autoCommit) spriteCommit(false);
+}
+
+
+
+void Sprite_set_x(NativeSprite *sprite, int x) {
+	SPRITE_ENTRY(sprite)->x = x;
+	if (sprite->motion != NULL) sprite->motion->x = x << 8;
 }
-FUNCTION(Sprite_get_affine) {
-	NOT_REMOVED(thisValue);
-	return getInternal(thisValue, "affine");
+int Sprite_get_x(NativeSprite *sprite) {
+	return SPRITE_ENTRY(sprite)->x;
 }
 
-FUNCTION(Sprite_set_sizeDouble) {
-	NOT_REMOVED(thisValue);
-	bool set = jerry_get_boolean_value(args[0]);
-	setInternal(thisValue, "sizeDouble", jerry_create_boolean(set));
-	SpriteEntry *sprite = SPRITE_ENTRY(thisValue);
-	if (sprite->isRotateScale) sprite->isSizeDouble = set;
-	return JS_UNDEFINED;
+void Sprite_set_y(NativeSprite *sprite, int y) {
+	SPRITE_ENTRY(sprite)->y = y;
+	if (sprite->motion != NULL) sprite->motion->y = y << 8;
 }
-FUNCTION(Sprite_get_sizeDouble) {
-	NOT_REMOVED(thisValue);
-	return getInternal(thisValue, "sizeDouble");
+int Sprite_get_y(NativeSprite *sprite) {
+	return SPRITE_ENTRY(sprite)->y;
+}
+
+void Sprite_setPosition(NativeSprite *sprite, int x, int y) {
+	OamState view = spriteView(sprite->main, sprite->id);
+	oamSetXY(&view, 0, x, y);
+	if (sprite->motion != NULL) {
+		sprite->motion->x = x << 8;
+		sprite->motion->y = y << 8;
+	}
 }
 
-FUNCTION(Sprite_set_mosaic) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENTRY(thisValue)->isMosaic = jerry_get_boolean_value(args[0]);
+FUNCTION(Sprite_set_gfx) {
+	NATIVE_THIS(NativeSprite, sprite);
+	NOT_REMOVED(sprite);
+	NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(args[0]);
+	EXPECT(graphic != NULL, SpriteGraphic);
+	NOT_REMOVED(graphic);
+	if (graphic->main != sprite->main) return TypeError("Given SpriteGraphic was from the wrong engine.");
+	OamState view = spriteView(sprite->main, sprite->id);
+	oamSetGfx(&view, 0, graphic->size, SPRITE_FORMAT(graphic->bpp), graphic->gfx);
+	setInternal(thisValue, "gfx", args[0]);
+	sprite->graphic = graphic;
+	// a graphic set by hand replaces the animation
+	sprite->animation = NULL;
+	setInternal(thisValue, "animation", JS_NULL);
 	return JS_UNDEFINED;
 }
-FUNCTION(Sprite_get_mosaic) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_boolean(SPRITE_ENTRY(thisValue)->isMosaic);
+FUNCTION(Sprite_get_gfx) {
+	NATIVE_THIS(NativeSprite, sprite);
+	NOT_REMOVED(sprite);
+	if (sprite->animation != NULL) return jerry_acquire_value(sprite->animation->frames[sprite->animationFrame].graphicObj);
+	return getInternal(thisValue, "gfx");
 }
 
-FUNCTION(Sprite_remove) {
-	NOT_REMOVED(thisValue);
-	OamState *engine = SPRITE_ENGINE(thisValue);
-	int id = getID(thisValue);
-	oamClearSprite(engine, id);
-	u8 usageMask = (engine == &oamMain ? USAGE_SPRITE_MAIN : USAGE_SPRITE_SUB);
-	spriteUsage[id] ^= ~usageMask;
-	jerry_set_internal_property(thisValue, ref_str_removed, JS_TRUE);
+FUNCTION(Sprite_set_animation) {
+	NATIVE_THIS(NativeSprite, sprite);
+	NOT_REMOVED(sprite);
+	NativeSpriteAnimation *animation = NULL;
+	if (!jerry_value_is_null(args[0])) {
+		animation = getNative<NativeSpriteAnimation>(args[0]);
+		EXPECT(animation != NULL, SpriteAnimation);
+		if (animation->main != sprite->main) return TypeError("Given SpriteAnimation was from the wrong engine.");
+		jerry_value_t graphicObj = getInternal(thisValue, "gfx");
+		bool bitmap = getNative<NativeSpriteGraphic>(graphicObj)->bpp == 16;
+		jerry_release_value(graphicObj);
+		if (bitmap != (animation->frames[0].graphic->bpp == 16)) return TypeError("Bitmap sprites can only be animated with bitmap graphics, and paletted sprites with paletted graphics.");
+	}
+	sprite->animation = animation;
+	setInternal(thisValue, "animation", args[0]);
+	if (animation != NULL) {
+		sprite->animationPlaying = true;
+		sprite->animationReverse = false;
+		spriteShowFrame(sprite, 0);
+	}
 	return JS_UNDEFINED;
 }
+FUNCTION(Sprite_get_animation) {
+	NATIVE_THIS(NativeSprite, sprite);
+	NOT_REMOVED(sprite);
+	return sprite->animation == NULL ? JS_NULL : getInternal(thisValue, "animation");
+}
 
-FUNCTION(SpriteGraphic_get_width) {
-	NOT_REMOVED(thisValue);
-	jerry_value_t sizeNum = getInternal(thisValue, "size");
-	SpriteSize size = (SpriteSize) jerry_value_as_uint32(sizeNum);
-	jerry_release_value(sizeNum);
-	if (size == SpriteSize_8x8 || size == SpriteSize_8x16 || size == SpriteSize_8x32) return jerry_create_number(8);
-	if (size == SpriteSize_16x8 || size == SpriteSize_16x16 || size == SpriteSize_16x32) return jerry_create_number(16);
-	if (size == SpriteSize_32x8 || size == SpriteSize_32x16 || size == SpriteSize_32x32 || size == SpriteSize_32x64) return jerry_create_number(32);
-	if (size == SpriteSize_64x32 || size == SpriteSize_64x64) return jerry_create_number(64);
-	return jerry_create_number_nan();
-}
-FUNCTION(SpriteGraphic_get_height) {
-	NOT_REMOVED(thisValue);
-	jerry_value_t sizeNum = getInternal(thisValue, "size");
-	SpriteSize size = (SpriteSize) jerry_value_as_uint32(sizeNum);
-	jerry_release_value(sizeNum);
-	if (size == SpriteSize_8x8 || size == SpriteSize_16x8 || size == SpriteSize_32x8) return jerry_create_number(8);
-	if (size == SpriteSize_8x16 || size == SpriteSize_16x16 || size == SpriteSize_32x16) return jerry_create_number(16);
-	if (size == SpriteSize_8x32 || size == SpriteSize_16x32 || size == SpriteSize_32x32 || size == SpriteSize_64x32) return jerry_create_number(32);
-	if (size == SpriteSize_32x64 || size == SpriteSize_64x64) return jerry_create_number(64);
-	return jerry_create_number_nan();
-}
-
-FUNCTION(SpriteGraphic_remove) {
-	NOT_REMOVED(thisValue);
-	jerry_value_t typedArray = getInternal(thisValue, "data");
-	jerry_length_t byteOffset, byteLength;
-	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(typedArray, &byteOffset, &byteLength);
-	u8 *gfxData = jerry_get_arraybuffer_pointer(arrayBuffer);
-	jerry_release_value(arrayBuffer);
-	jerry_release_value(typedArray);
-	oamFreeGfx(SPRITE_ENGINE(thisValue), gfxData);
-	jerry_set_internal_property(thisValue, ref_str_removed, JS_TRUE);
-	return JS_UNDEFINED;
+void Sprite_set_animationFrame(NativeSprite *sprite, int frame) {
+	if (sprite->animation != NULL) spriteShowFrame(sprite, BOUND(frame, 0, (int) sprite->animation->frames.size() - 1));
+}
+int Sprite_get_animationFrame(NativeSprite *sprite) {
+	return sprite->animation == NULL ? 0 : sprite->animationFrame;
 }
 
-FUNCTION(SpriteAffineMatrix_set_hdx) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].hdx = floatToFixed(jerry_get_number_value(args[0]), 8);
-	return JS_UNDEFINED;
+void Sprite_set_animationPlaying(NativeSprite *sprite, bool playing) {
+	// an animation that ran to its end starts over
+	if (playing && sprite->animation != NULL && sprite->frameTime == 0) spriteShowFrame(sprite, 0);
+	sprite->animationPlaying = playing;
 }
-FUNCTION(SpriteAffineMatrix_get_hdx) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(fixedToFloat(SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].hdx, 8));
+bool Sprite_get_animationPlaying(NativeSprite *sprite) {
+	return sprite->animation != NULL && sprite->animationPlaying;
 }
-FUNCTION(SpriteAffineMatrix_set_hdy) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].hdy = floatToFixed(jerry_get_number_value(args[0]), 8);
-	return JS_UNDEFINED;
+
+void Sprite_set_palette(NativeSprite *sprite, int palette) {
+	SPRITE_ENTRY(sprite)->palette = BOUND(palette, 0, 15);
 }
-FUNCTION(SpriteAffineMatrix_get_hdy) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(fixedToFloat(SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].hdy, 8));
+int Sprite_get_palette(NativeSprite *sprite) {
+	return SPRITE_ENTRY(sprite)->palette;
 }
-FUNCTION(SpriteAffineMatrix_set_vdx) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].vdx = floatToFixed(jerry_get_number_value(args[0]), 8);
-	return JS_UNDEFINED;
+
+void Sprite_set_priority(NativeSprite *sprite, int priority) {
+	OamState view = spriteView(sprite->main, sprite->id);
+	oamSetPriority(&view, 0, BOUND(priority, 0, 3));
 }
-FUNCTION(SpriteAffineMatrix_get_vdx) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(fixedToFloat(SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].vdx, 8));
+int Sprite_get_priority(NativeSprite *sprite) {
+	return SPRITE_ENTRY(sprite)->priority;
 }
-FUNCTION(SpriteAffineMatrix_set_vdy) {
-	NOT_REMOVED(thisValue);
-	SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].vdy = floatToFixed(jerry_get_number_value(args[0]), 8);
-	return JS_UNDEFINED;
+
+void Sprite_set_hidden(NativeSprite *sprite, bool hidden) {
+	spriteApplyAffine(sprite, SPRITE_ENTRY(sprite), hidden);
 }
-FUNCTION(SpriteAffineMatrix_get_vdy) {
-	NOT_REMOVED(thisValue);
-	return jerry_create_number(fixedToFloat(SPRITE_ENGINE(thisValue)->oamRotationMemory[getID(thisValue)].vdy, 8));
+bool Sprite_get_hidden(NativeSprite *sprite) {
+	SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	return entry->isHidden && !entry->isRotateScale;
 }
 
-FUNCTION(SpriteAffineMatrix_rotateScale) {
-	NOT_REMOVED(thisValue);
-	REQUIRE(3);
-	int angle = degreesToAngle(jerry_value_as_int32(args[0]));
-	int sx = floatToFixed(jerry_get_number_value(args[1]), 8);
-	int sy = floatToFixed(jerry_get_number_value(args[2]), 8);
-	oamRotateScale(SPRITE_ENGINE(thisValue), getID(thisValue), angle, sx, sy);
+void Sprite_set_flipH(NativeSprite *sprite, bool flipH) {
+	sprite->flipH = flipH;
+	SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	if (!entry->isRotateScale) entry->hFlip = flipH;
+}
+bool Sprite_get_flipH(NativeSprite *sprite) {
+	return sprite->flipH;
+}
+
+void Sprite_set_flipV(NativeSprite *sprite, bool flipV) {
+	sprite->flipV = flipV;
+	SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	if (!entry->isRotateScale) entry->vFlip = flipV;
+}
+bool Sprite_get_flipV(NativeSprite *sprite) {
+	return sprite->flipV;
+}
+
+JS_value Sprite_set_affine(NativeSprite *sprite, std::optional<NativeArg<NativeSpriteAffineMatrix>> matrix) {
+	if (matrix && (*matrix)->main != sprite->main) return TypeError("Given SpriteAffineMatrix was from the wrong engine.");
+	SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	bool hidden = entry->isHidden && !entry->isRotateScale;
+	sprite->affineID = matrix ? (*matrix)->id : -1;
+	spriteApplyAffine(sprite, entry, hidden);
 	return JS_UNDEFINED;
 }
+JS_value Sprite_get_affine(NativeSprite *sprite) {
+	if (!matrixInUse(sprite->main, sprite->affineID)) return JS_NULL;
+	return jerry_acquire_value(matrixSlots[ENGINE_INDEX(sprite)][sprite->affineID]);
+}
+
+void Sprite_set_sizeDouble(NativeSprite *sprite, bool sizeDouble) {
+	sprite->sizeDouble = sizeDouble;
+	SpriteEntry *entry = SPRITE_ENTRY(sprite);
+	if (entry->isRotateScale) entry->isSizeDouble = sizeDouble;
+}
+bool Sprite_get_sizeDouble(NativeSprite *sprite) {
+	return sprite->sizeDouble;
+}
+
+void Sprite_set_mosaic(NativeSprite *sprite, bool mosaic) {
+	SPRITE_ENTRY(sprite)->isMosaic = mosaic;
+}
+bool Sprite_get_mosaic(NativeSprite *sprite) {
+	return SPRITE_ENTRY(sprite)->isMosaic;
+}
 
-FUNCTION(SpriteAffineMatrix_remove) {
-	NOT_REMOVED(thisValue);
-	u8 usageMask = (testInternal(thisValue, ref_str_main) ? USAGE_MATRIX_MAIN : USAGE_MATRIX_SUB);
-	spriteUsage[getID(thisValue)] ^= ~usageMask;
-	jerry_set_internal_property(thisValue, ref_str_removed, JS_TRUE);
+template <s32 SpriteMotion::*member>
+void Sprite_set_motion(NativeSprite *sprite, double value) {
+	spriteMotion(sprite)->*member = floatToFixed(value, 8);
+}
+template <s32 SpriteMotion::*member>
+double Sprite_get_motion(NativeSprite *sprite) {
+	return sprite->motion == NULL ? 0 : fixedToFloat(sprite->motion->*member, 8);
+}
+
+void Sprite_set_friction(NativeSprite *sprite, double friction) {
+	spriteMotion(sprite)->friction = floatToFixed(BOUND(friction, 0, 1), 8);
+}
+
+FUNCTION(Sprite_setBounds) {
+	NATIVE_THIS(NativeSprite, sprite);
+	NOT_REMOVED(sprite);
+	REQUIRE(4);
+	MotionBounds bounds = BOUNDS_CLAMP;
+	if (argCount > 4 && !jerry_value_is_undefined(args[4])) {
+		char *modeStr = toRawString(args[4]);
+		bool valid = true;
+		if (strcmp(modeStr, "wrap") == 0) bounds = BOUNDS_WRAP;
+		else if (strcmp(modeStr, "bounce") == 0) bounds = BOUNDS_BOUNCE;
+		else valid = strcmp(modeStr, "clamp") == 0;
+		free(modeStr);
+		if (!valid) return TypeError("Expected a bounds mode of 'clamp', 'wrap', or 'bounce'.");
+	}
+	SpriteMotion *motion = spriteMotion(sprite);
+	motion->bounds = bounds;
+	motion->left = jerry_value_as_int32(args[0]);
+	motion->top = jerry_value_as_int32(args[1]);
+	motion->right = jerry_value_as_int32(args[2]);
+	motion->bottom = jerry_value_as_int32(args[3]);
 	return JS_UNDEFINED;
 }
 
-FUNCTION(SpriteEngine_init) {
+// Stops integrating the sprite's motion altogether.
+void Sprite_stop(NativeSprite *sprite) {
+	delete sprite->motion;
+	sprite->motion = NULL;
+}
+
+// Frees a sprite's slot, along with its motion and the hold on its object, which only last while it's in use.
+void spriteFreeSlot(NativeSprite *sprite) {
+	spriteInUse[ENGINE_INDEX(sprite)][sprite->id] = false;
+	spriteSlots[ENGINE_INDEX(sprite)][sprite->id] = NULL;
+	sprite->removed = true;
+	delete sprite->motion;
+	sprite->motion = NULL;
+	releaseNativeListeners(sprite->listenerCount);
+	jerry_release_value(sprite->object);
+}
+
+void Sprite_remove(NativeSprite *sprite) {
+	OamState view = spriteView(sprite->main, sprite->id);
+	oamClearSprite(&view, 0);
+	spriteFreeSlot(sprite);
+}
+
+void SpriteGraphic_remove(NativeSpriteGraphic *graphic) {
+	gfxFree(graphic);
+	detachGraphicData(graphic);
+	graphic->removed = true;
+}
+
+FUNCTION(SpriteGraphic_get_data) {
+	NATIVE_THIS(NativeSpriteGraphic, graphic);
+	return jerry_acquire_value(graphic->data);
+}
+
+void SpriteAffineMatrix_set_hdx(NativeSpriteAffineMatrix *matrix, double hdx) {
+	SPRITE_MATRIX(matrix)->hdx = floatToFixed(hdx, 8);
+}
+double SpriteAffineMatrix_get_hdx(NativeSpriteAffineMatrix *matrix) {
+	return fixedToFloat(SPRITE_MATRIX(matrix)->hdx, 8);
+}
+void SpriteAffineMatrix_set_hdy(NativeSpriteAffineMatrix *matrix, double hdy) {
+	SPRITE_MATRIX(matrix)->hdy = floatToFixed(hdy, 8);
+}
+double SpriteAffineMatrix_get_hdy(NativeSpriteAffineMatrix *matrix) {
+	return fixedToFloat(SPRITE_MATRIX(matrix)->hdy, 8);
+}
+void SpriteAffineMatrix_set_vdx(NativeSpriteAffineMatrix *matrix, double vdx) {
+	SPRITE_MATRIX(matrix)->vdx = floatToFixed(vdx, 8);
+}
+double SpriteAffineMatrix_get_vdx(NativeSpriteAffineMatrix *matrix) {
+	return fixedToFloat(SPRITE_MATRIX(matrix)->vdx, 8);
+}
+void SpriteAffineMatrix_set_vdy(NativeSpriteAffineMatrix *matrix, double vdy) {
+	SPRITE_MATRIX(matrix)->vdy = floatToFixed(vdy, 8);
+}
+double SpriteAffineMatrix_get_vdy(NativeSpriteAffineMatrix *matrix) {
+	return fixedToFloat(SPRITE_MATRIX(matrix)->vdy, 8);
+}
+
+void SpriteAffineMatrix_rotateScale(NativeSpriteAffineMatrix *matrix, int angle, double sx, double sy) {
+	oamRotateScale(SPRITE_ENGINE(matrix), matrix->id, degreesToAngle(angle), floatToFixed(sx, 8), floatToFixed(sy, 8));
+}
+
+void SpriteAffineMatrix_remove(NativeSpriteAffineMatrix *matrix) {
+	spriteUsage[matrix->id] &= ~(matrix->main ? USAGE_MATRIX_MAIN : USAGE_MATRIX_SUB);
+	jerry_release_value(matrixSlots[ENGINE_INDEX(matrix)][matrix->id]);
+	matrix->removed = true;
+}
+
+JS_value SpriteEngine_init(
+	NativeSpriteEngine *engine, std::optional<bool> allowBitmaps, std::optional<bool> use2DMapping, std::optional<int> boundarySize,
+	std::optional<bool> useExternalPalettes, std::optional<bool> multiplex
+) {
 	SpriteMapping mapping;
-	bool allowBitmaps = argCount > 0 && jerry_get_boolean_value(args[0]);
-	bool use2DMapping = argCount > 1 && jerry_get_boolean_value(args[1]);
-	int boundarySizeSet = argCount > 2 && !jerry_value_is_undefined(args[2]);
-	int boundarySize = boundarySizeSet ? jerry_value_as_int32(args[2]) : 0;
-	bool useExternalPalettes = argCount > 3 && jerry_get_boolean_value(args[3]);
-	if (allowBitmaps) {
-		if (!boundarySizeSet || boundarySize == 128) mapping = use2DMapping ? SpriteMapping_Bmp_2D_128 : SpriteMapping_Bmp_1D_128;
-		else if (boundarySize == 256) mapping = use2DMapping ? SpriteMapping_Bmp_2D_256 : SpriteMapping_Bmp_1D_256;
+	if (allowBitmaps.value_or(false)) {
+		if (boundarySize.value_or(128) == 128) mapping = use2DMapping.value_or(false) ? SpriteMapping_Bmp_2D_128 : SpriteMapping_Bmp_1D_128;
+		else if (boundarySize == 256) mapping = use2DMapping.value_or(false) ? SpriteMapping_Bmp_2D_256 : SpriteMapping_Bmp_1D_256;
 		else return TypeError("Boundary size for bitmap sprites should be 128 or 256.");
 	}
-	else if (use2DMapping) {
-		if (!boundarySizeSet || boundarySize == 32) mapping = SpriteMapping_2D;
+	else if (use2DMapping.value_or(false)) {
+		if (boundarySize.value_or(32) == 32) mapping = SpriteMapping_2D;
 		else return TypeError("Boundary size for 2D sprite tiles should be 32.");
 	}
-	else if (!boundarySizeSet || boundarySize == 32) mapping = SpriteMapping_1D_32;
+	else if (boundarySize.value_or(32) == 32) mapping = SpriteMapping_1D_32;
 	else if (boundarySize == 64) mapping = SpriteMapping_1D_64;
 	else if (boundarySize == 128) mapping = SpriteMapping_1D_128;
 	else if (boundarySize == 256) mapping = SpriteMapping_1D_256;
 	else return TypeError("Boundary size for 1D sprite tiles should be 32, 64, 128, or 256.");
-	bool isMain = testInternal(thisValue, ref_str_main);
-	oamInit(isMain ? &oamMain : &oamSub, mapping, useExternalPalettes);
-	if (isMain) spriteUpdateMain = true;
+	oamInit(SPRITE_ENGINE(engine), mapping, useExternalPalettes.value_or(false));
+	if (engine->main) spriteUpdateMain = true;
 	else spriteUpdateSub = true;
+
+	// sprites and graphics added before don't survive reinitializing
+	int idx = ENGINE_INDEX(engine);
+	for (int i = 0; i < VIRTUAL_SPRITE_COUNT; i++) {
+		if (spriteSlots[idx][i] != NULL) spriteFreeSlot(spriteSlots[idx][i]);
+		spriteInUse[idx][i] = false;
+	}
+	multiplexSetEnabled(idx, multiplex.value_or(false));
+	GfxAllocator &allocator = gfxAllocators[idx];
+	for (GfxBlock &block : allocator.blocks) {
+		if (block.owner == NULL) continue;
+		detachGraphicData(block.owner);
+		block.owner->removed = true;
+	}
+	allocator.blocks.clear();
+	allocator.linear = mapping != SpriteMapping_2D && mapping != SpriteMapping_Bmp_2D_128 && mapping != SpriteMapping_Bmp_2D_256;
+	allocator.boundary = allowBitmaps.value_or(false) ? boundarySize.value_or(128) : boundarySize.value_or(32);
+	allocator.capacity = 1024;
+	if (allocator.capacity * allocator.boundary > (engine->main ? 256 : 128) * 1024) allocator.capacity = (engine->main ? 256 : 128) * 1024 / allocator.boundary;
+	spriteCommit(engine->main);
 	return JS_UNDEFINED;
 }
 
-FUNCTION(SpriteEngine_enable) {
-	bool isMain = testInternal(thisValue, ref_str_main);
-	oamEnable(isMain ? &oamMain : &oamSub);
-	if (isMain) spriteUpdateMain = true;
+void SpriteEngine_enable(NativeSpriteEngine *engine) {
+	oamEnable(SPRITE_ENGINE(engine));
+	if (engine->main) spriteUpdateMain = true;
 	else spriteUpdateSub = true;
-	return JS_UNDEFINED;
 }
-FUNCTION(SpriteEngine_disable) {
-	bool isMain = testInternal(thisValue, ref_str_main);
-	oamDisable(isMain ? &oamMain : &oamSub);
-	if (isMain) spriteUpdateMain = false;
+void SpriteEngine_disable(NativeSpriteEngine *engine) {
+	oamDisable(SPRITE_ENGINE(engine));
+	if (engine->main) spriteUpdateMain = false;
 	else spriteUpdateSub = false;
-	return JS_UNDEFINED;
 }
 
-FUNCTION(SpriteEngine_addSprite) {
-	REQUIRE(3);
-	EXPECT(isInstance(args[2], ref_SpriteGraphic), SpriteGraphic);
-	NOT_REMOVED(args[2]);
-	OamState *engine = SPRITE_ENGINE(thisValue);
-	if (SPRITE_ENGINE(args[2]) != engine) return TypeError("Given SpriteGraphic was from the wrong engine.");
-	bool setsAffine = argCount > 8 && !jerry_value_is_undefined(args[8]) && !jerry_value_is_null(args[8]);
-	if (setsAffine) {
-		EXPECT(isInstance(args[8], ref_SpriteAffineMatrix), SpriteAffineMatrix);
-		NOT_REMOVED(args[8]);
-		if (SPRITE_ENGINE(args[8]) != engine) return TypeError("Given SpriteAffineMatrix was from the wrong engine.");
-	}
+JS_value SpriteEngine_addSprite(
+	NativeSpriteEngine *engine, int x, int y, NativeArg<NativeSpriteGraphic> graphic,
+	std::optional<int> paletteOrAlpha, std::optional<int> priority, std::optional<bool> hide, std::optional<bool> flipH, std::optional<bool> flipV,
+	std::optional<NativeArg<NativeSpriteAffineMatrix>> matrix, std::optional<bool> sizeDouble, std::optional<bool> mosaic
+) {
+	if (graphic->main != engine->main) return TypeError("Given SpriteGraphic was from the wrong engine.");
+	if (matrix && (*matrix)->main != engine->main) return TypeError("Given SpriteAffineMatrix was from the wrong engine.");
 
+	int idx = ENGINE_INDEX(engine);
 	int id = -1;
-	u8 usageMask = engine == &oamMain ? USAGE_SPRITE_MAIN : USAGE_SPRITE_SUB;
-	for (int i = 0; i < SPRITE_COUNT; i++) {
-		if ((spriteUsage[i] & usageMask) == 0) {
-			spriteUsage[i] |= usageMask;
+	for (int i = 0; i < SPRITE_LIMIT(idx); i++) {
+		if (!spriteInUse[idx][i]) {
+			spriteInUse[idx][i] = true;
 			id = i;
 			break;
 		}
 	}
 	if (id == -1) return Error("Out of sprite slots.");
 
-	jerry_value_t sizeNum = getInternal(args[2], "size");
-	jerry_value_t bppNum = getInternal(args[2], "colorFormat");
-	SpriteSize size = (SpriteSize) jerry_value_as_uint32(sizeNum);
-	int bpp = jerry_value_as_int32(bppNum);
-	jerry_release_value(sizeNum);
-	jerry_release_value(bppNum);
-	jerry_value_t typedArray = getInternal(args[2], "data");
-	jerry_length_t byteOffset, arrayBufferLen;
-	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(typedArray, &byteOffset, &arrayBufferLen);
-	u8 *gfxData = jerry_get_arraybuffer_pointer(arrayBuffer);
-	jerry_release_value(arrayBuffer);
-	jerry_release_value(typedArray);
-
-	int x = jerry_value_as_int32(args[0]);
-	int y = jerry_value_as_int32(args[1]);
-	int paletteOrAlpha = argCount > 3 ? jerry_value_as_int32(args[3]) : 0;
-	int priority = argCount > 4 ? jerry_value_as_int32(args[4]) : 0;
-	bool hide = argCount > 5 && jerry_get_boolean_value(args[5]);
-	bool flipH = !setsAffine && argCount > 6 && jerry_get_boolean_value(args[6]);
-	bool flipV = !setsAffine && argCount > 7 && jerry_get_boolean_value(args[7]);
-	int affineIndex = setsAffine ? getID(args[8]) : -1;
-	bool sizeDouble = argCount > 9 && jerry_get_boolean_value(args[9]);
-	bool mosaic = argCount > 10 && jerry_get_boolean_value(args[10]);
+	int palette = paletteOrAlpha.value_or(0), layer = priority.value_or(0);
+	bool hidden = hide.value_or(false);
+	bool flippedH = !matrix && flipH.value_or(false);
+	bool flippedV = !matrix && flipV.value_or(false);
+	int affineIndex = matrix ? (*matrix)->id : -1;
 
+	OamState view = spriteView(engine->main, id);
 	oamSet(
-		engine, id, x, y,
-		BOUND(priority, 0, 3),
-		BOUND(paletteOrAlpha, 0, 15),
-		size,
-		bpp == 4 ? SpriteColorFormat_16Color : bpp == 8 ? SpriteColorFormat_256Color : SpriteColorFormat_Bmp,
-		gfxData,
-		hide ? -1 : affineIndex,
-		sizeDouble, false, flipH, flipV, mosaic
+		&view, 0, x, y,
+		BOUND(layer, 0, 3),
+		BOUND(palette, 0, 15),
+		graphic->size,
+		SPRITE_FORMAT(graphic->bpp),
+		graphic->gfx,
+		hidden ? -1 : affineIndex,
+		sizeDouble.value_or(false), false, flippedH, flippedV, mosaic.value_or(false)
 	);
 	// set hidden flag manually, because oamSet ignores the other parameters if hide is true.
-	if (hide) engine->oamMemory[id].isHidden = true;
+	if (hidden) view.oamMemory->isHidden = true;
 
 	jerry_value_t spriteObj = jerry_create_object();
-	setInternal(spriteObj, "id", (double) id);
-	defReadonly(spriteObj, ref_str_main, jerry_get_internal_property(thisValue, ref_str_main));
-	setPrototype(spriteObj, bpp == 16 ? ref_BitmapSprite.prototype : ref_PalettedSprite.prototype);
-	setInternal(spriteObj, "flipH", JS_FALSE);
-	setInternal(spriteObj, "flipV", JS_FALSE);
-	setInternal(spriteObj, "affine", setsAffine ? args[8] : JS_NULL);
-	setInternal(spriteObj, "sizeDouble", jerry_create_boolean(sizeDouble));
+	jerry_value_t eventListenersObj = jerry_create_object();
+	setInternal(spriteObj, "eventListeners", eventListenersObj);
+	jerry_release_value(eventListenersObj);
+	spriteSlots[idx][id] = setNative(spriteObj, new NativeSprite{
+		.id = (u16) id,
+		.main = engine->main,
+		.removed = false,
+		.flipH = flippedH,
+		.flipV = flippedV,
+		.sizeDouble = sizeDouble.value_or(false),
+		.affineID = affineIndex,
+		.z = 0,
+		.graphic = graphic.native,
+		.object = jerry_acquire_value(spriteObj),
+		.animation = NULL,
+		.animationFrame = 0,
+		.frameTime = 0,
+		.animationPlaying = false,
+		.animationReverse = false,
+		.motion = NULL,
+		.listenerCount = 0
+	});
+	setPrototype(spriteObj, graphic->bpp == 16 ? ref_BitmapSprite.prototype : ref_PalettedSprite.prototype);
+	setInternal(spriteObj, "gfx", graphic.value);
 	return spriteObj;
 }
 
-FUNCTION(SpriteEngine_addGraphic) {
-	REQUIRE(3);
-	if (argCount > 3) EXPECT(jerry_value_is_typedarray(args[3]), TypedArray);
-	int width = jerry_value_as_int32(args[0]);
-	int height = jerry_value_as_int32(args[1]);
-	int bpp = jerry_value_as_int32(args[2]);
-
+// Allocates graphics memory and creates a SpriteGraphic for it, or returns an error. Return value must be released!
+jerry_value_t spriteCreateGraphic(NativeSpriteEngine *engine, int width, int height, int bpp) {
 	SpriteSize size;
 	if (width > 64) return TypeError("Sprite width is above the limit of 64.");
 	if (height > 64) return TypeError("Sprite height is above the limit of 64.");
@@ -490,39 +1006,189 @@ FUNCTION(SpriteEngine_addGraphic) {
 	else if (bpp == 16) format = SpriteColorFormat_Bmp;
 	else return TypeError("Expected a bits-per-pixel value of either 4, 8, or 16.");
 	
-	OamState *engine = SPRITE_ENGINE(thisValue);
-	u16 *gfxData = oamAllocateGfx(engine, size, format);
-	if (engine->firstFree == -1) return Error("Out of sprite graphics memory.");
 	u32 byteSize = SPRITE_SIZE_PIXELS(size);
 	if (bpp == 4) byteSize /= 2;
 	else if (bpp == 16) byteSize *= 2;
 
-	if (argCount > 3) {
-		jerry_length_t byteOffset, inputArrayBufferLen;
-		jerry_value_t inputArrayBuffer = jerry_get_typedarray_buffer(args[3], &byteOffset, &inputArrayBufferLen);
-		jerry_arraybuffer_read(inputArrayBuffer, byteOffset, (u8 *) gfxData, byteSize < inputArrayBufferLen ? byteSize : inputArrayBufferLen);
-		jerry_release_value(inputArrayBuffer);
+	int idx = ENGINE_INDEX(engine);
+	GfxAllocator &allocator = gfxAllocators[idx];
+	u16 *gfxData;
+	int blockIdx = -1;
+	if (allocator.linear) {
+		if (allocator.boundary == 0) return Error("Out of sprite graphics memory.");
+		u16 units = (byteSize + allocator.boundary - 1) / allocator.boundary;
+		blockIdx = gfxFindSpace(allocator, units);
+		if (blockIdx == -1) {
+			gfxDefragment(idx);
+			blockIdx = gfxFindSpace(allocator, units);
+			if (blockIdx == -1) return Error("Out of sprite graphics memory.");
+		}
+		gfxData = gfxBase(idx) + allocator.blocks[blockIdx].offset * allocator.boundary / 2;
+	}
+	else {
+		OamState *oam = SPRITE_ENGINE(engine);
+		gfxData = oamAllocateGfx(oam, size, format);
+		if (oam->firstFree == -1) return Error("Out of sprite graphics memory.");
 	}
 
-	jerry_value_t arrayBuffer = jerry_create_arraybuffer_external(byteSize, (u8 *) gfxData, [](void * _){});
-	jerry_value_t typedArray = jerry_create_typedarray_for_arraybuffer(JERRY_TYPEDARRAY_UINT8, arrayBuffer);
-	jerry_release_value(arrayBuffer);
-	
 	jerry_value_t spriteGraphicObj = jerry_create_object();
-	defReadonly(spriteGraphicObj, ref_str_main, jerry_get_internal_property(thisValue, ref_str_main));
+	NativeSpriteGraphic *graphic = setNative(spriteGraphicObj, new NativeSpriteGraphic{
+		.main = engine->main,
+		.removed = false,
+		.size = size,
+		.bpp = (u8) bpp,
+		.width = spriteSizeWidth(size),
+		.height = spriteSizeHeight(size),
+		.gfx = gfxData,
+		.byteSize = byteSize,
+		.data = createGraphicData(gfxData, byteSize),
+		.touchMask = false
+	});
+	if (blockIdx != -1) allocator.blocks[blockIdx].owner = graphic;
 	setPrototype(spriteGraphicObj, ref_SpriteGraphic.prototype);
-	defReadonly(spriteGraphicObj, "colorFormat", args[2]);
-	setInternal(spriteGraphicObj, "size", (double) size);
-	defReadonly(spriteGraphicObj, "data", typedArray);
-	jerry_release_value(typedArray);
 	return spriteGraphicObj;
 }
 
-FUNCTION(SpriteEngine_addAffineMatrix) {
-	OamState *engine = SPRITE_ENGINE(thisValue);
+FUNCTION(SpriteEngine_addGraphic) {
+	NATIVE_THIS(NativeSpriteEngine, engine);
+	REQUIRE(3);
+	if (argCount > 3) EXPECT(jerry_value_is_typedarray(args[3]), TypedArray);
+	bool compressed = argCount > 4 && jerry_value_to_boolean(args[4]);
+	jerry_length_t byteOffset, inputArrayBufferLen;
+	jerry_value_t inputArrayBuffer = argCount > 3 ? jerry_get_typedarray_buffer(args[3], &byteOffset, &inputArrayBufferLen) : JS_UNDEFINED;
+	u8 *compressedData = NULL;
+	u32 uncompressedSize = 0;
+	if (compressed) {
+		compressedData = jerry_get_arraybuffer_pointer(inputArrayBuffer);
+		if (compressedData != NULL) uncompressedSize = decompressedSize(compressedData += byteOffset, inputArrayBufferLen);
+		if (uncompressedSize == 0) {
+			jerry_release_value(inputArrayBuffer);
+			return TypeError("Expected LZ77, Huffman, or RLE compressed data.");
+		}
+	}
+	jerry_value_t spriteGraphicObj = spriteCreateGraphic(engine, jerry_value_as_int32(args[0]), jerry_value_as_int32(args[1]), jerry_value_as_int32(args[2]));
+	if (argCount > 3 && !jerry_value_is_error(spriteGraphicObj)) {
+		NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(spriteGraphicObj);
+		if (!compressed) {
+			jerry_arraybuffer_read(inputArrayBuffer, byteOffset, (u8 *) graphic->gfx, graphic->byteSize < inputArrayBufferLen ? graphic->byteSize : inputArrayBufferLen);
+		}
+		else if (((uncompressedSize + 3) & ~3) > graphic->byteSize) {
+			SpriteGraphic_remove(graphic);
+			jerry_release_value(spriteGraphicObj);
+			spriteGraphicObj = RangeError("Decompressed data is larger than the graphic.");
+		}
+		else if (!decompressVram(compressedData, inputArrayBufferLen, graphic->gfx)) {
+			SpriteGraphic_remove(graphic);
+			jerry_release_value(spriteGraphicObj);
+			spriteGraphicObj = Error("Not enough memory to decompress the data.");
+		}
+	}
+	jerry_release_value(inputArrayBuffer);
+	return spriteGraphicObj;
+}
+
+/* Reads graphics data from a file into VRAM. VRAM can't be written a byte at a time,
+ * so data goes through a bounce buffer and is copied by DMA, which needs it flushed from cache first.
+ */
+bool readGraphicData(FILE *file, u16 *gfx, u32 byteSize) {
+	alignas(32) static u8 buffer[2048];
+	for (u32 done = 0; done < byteSize;) {
+		u32 chunk = byteSize - done < sizeof(buffer) ? byteSize - done : sizeof(buffer);
+		if (fread(buffer, 1, chunk, file) != chunk) return false;
+		DC_FlushRange(buffer, chunk);
+		dmaCopy(buffer, (u8 *) gfx + done, chunk);
+		done += chunk;
+	}
+	return true;
+}
+
+// Reads compressed graphics data from a file and decompresses it into VRAM.
+bool readCompressedGraphicData(FILE *file, u16 *gfx, u32 byteSize, u32 compressedSize) {
+	u8 *data = (u8 *) malloc(compressedSize);
+	if (data == NULL) return false;
+	u32 size = 0;
+	bool success = fread(data, 1, compressedSize, file) == compressedSize
+		&& (size = decompressedSize(data, compressedSize)) != 0
+		&& ((size + 3) & ~3) <= byteSize
+		&& decompressVram(data, compressedSize, gfx);
+	free(data);
+	return success;
+}
+
+/* Creates count graphics of the same size, read one after another from a file starting at offset.
+ * Returns a single graphic when asArray is false. Data is compressed unless compressedSize is 0.
+ */
+jerry_value_t spriteLoadGraphics(NativeSpriteEngine *engine, jerry_value_t pathValue, u32 offset, int width, int height, int bpp, u32 count, bool asArray, u32 compressedSize) {
+	char *path = toRawString(pathValue);
+	FILE *file = fopen(path, "rb");
+	free(path);
+	if (file == NULL) return Error("Unable to open file.");
+	if (fseek(file, offset, SEEK_SET) != 0) {
+		fclose(file);
+		return Error("Unable to seek file.");
+	}
+	jerry_value_t graphicsArr = asArray ? jerry_create_array(count) : JS_UNDEFINED;
+	jerry_value_t result = JS_UNDEFINED;
+	for (u32 i = 0; i < count; i++) {
+		jerry_value_t spriteGraphicObj = spriteCreateGraphic(engine, width, height, bpp);
+		if (jerry_value_is_error(spriteGraphicObj)) {
+			result = spriteGraphicObj;
+			break;
+		}
+		NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(spriteGraphicObj);
+		bool success = compressedSize == 0
+			? readGraphicData(file, graphic->gfx, graphic->byteSize)
+			: readCompressedGraphicData(file, graphic->gfx, graphic->byteSize, compressedSize);
+		if (!success) SpriteGraphic_remove(graphic);
+		if (asArray) jerry_release_value(jerry_set_property_by_index(graphicsArr, i, spriteGraphicObj));
+		else result = jerry_acquire_value(spriteGraphicObj);
+		jerry_release_value(spriteGraphicObj);
+		if (!success) {
+			jerry_release_value(result);
+			result = Error("Unable to read graphics from file.");
+			break;
+		}
+	}
+	fclose(file);
+	if (!asArray) return result;
+	if (jerry_value_is_error(result)) {
+		// graphics read before the failure are freed, since the script never gets them
+		for (u32 i = 0; i < count; i++) {
+			jerry_value_t spriteGraphicObj = jerry_get_property_by_index(graphicsArr, i);
+			NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(spriteGraphicObj);
+			if (graphic != NULL && !graphic->removed) SpriteGraphic_remove(graphic);
+			jerry_release_value(spriteGraphicObj);
+		}
+		jerry_release_value(graphicsArr);
+		return result;
+	}
+	return graphicsArr;
+}
+
+FUNCTION(SpriteEngine_loadGraphic) {
+	NATIVE_THIS(NativeSpriteEngine, engine);
+	REQUIRE(5);
+	return spriteLoadGraphics(
+		engine, args[0], jerry_value_as_uint32(args[1]),
+		jerry_value_as_int32(args[2]), jerry_value_as_int32(args[3]), jerry_value_as_int32(args[4]), 1, false,
+		argCount > 5 ? jerry_value_as_uint32(args[5]) : 0
+	);
+}
+
+FUNCTION(SpriteEngine_loadSheet) {
+	NATIVE_THIS(NativeSpriteEngine, engine);
+	REQUIRE(6);
+	u32 count = jerry_value_as_uint32(args[5]);
+	if (count == 0 || count > 1024) return RangeError("Expected between 1 and 1024 graphics.");
+	return spriteLoadGraphics(
+		engine, args[0], jerry_value_as_uint32(args[1]),
+		jerry_value_as_int32(args[2]), jerry_value_as_int32(args[3]), jerry_value_as_int32(args[4]), count, true, 0
+	);
+}
 
+JS_value SpriteEngine_addAffineMatrix(NativeSpriteEngine *engine, std::optional<double> hdx, std::optional<double> hdy, std::optional<double> vdx, std::optional<double> vdy) {
 	int id = -1;
-	u8 usageMask = engine == &oamMain ? USAGE_MATRIX_MAIN : USAGE_MATRIX_SUB;
+	u8 usageMask = engine->main ? USAGE_MATRIX_MAIN : USAGE_MATRIX_SUB;
 	for (int i = 0; i < MATRIX_COUNT; i++) {
 		if ((spriteUsage[i] & usageMask) == 0) {
 			spriteUsage[i] |= usageMask;
@@ -532,29 +1198,114 @@ FUNCTION(SpriteEngine_addAffineMatrix) {
 	}
 	if (id == -1) return Error("Out of affine matrix slots.");
 
-	int hdx = argCount > 0 ? floatToFixed(jerry_get_number_value(args[0]), 8) : (1 << 8);
-	int hdy = argCount > 1 ? floatToFixed(jerry_get_number_value(args[1]), 8) : 0;
-	int vdx = argCount > 2 ? floatToFixed(jerry_get_number_value(args[2]), 8) : 0;
-	int vdy = argCount > 3 ? floatToFixed(jerry_get_number_value(args[3]), 8) : (1 << 8);
-	oamAffineTransformation(engine, id, hdx, hdy, vdx, vdy);
+	oamAffineTransformation(
+		SPRITE_ENGINE(engine), id,
+		floatToFixed(hdx.value_or(1), 8),
+		floatToFixed(hdy.value_or(0), 8),
+		floatToFixed(vdx.value_or(0), 8),
+		floatToFixed(vdy.value_or(1), 8)
+	);
 	
 	jerry_value_t affineObj = jerry_create_object();
-	setInternal(affineObj, "id", (double) id);
-	defReadonly(affineObj, ref_str_main, jerry_get_internal_property(thisValue, ref_str_main));
+	setNative(affineObj, new NativeSpriteAffineMatrix{.id = (u8) id, .main = engine->main, .removed = false});
 	setPrototype(affineObj, ref_SpriteAffineMatrix.prototype);
+	matrixSlots[ENGINE_INDEX(engine)][id] = jerry_acquire_value(affineObj);
 	return affineObj;
 }
 
-FUNCTION(SpriteEngine_setMosaic) {
+const u32 BATCH_FIELDS = 6;
+FUNCTION(SpriteEngine_updateBatch) {
+	NATIVE_THIS(NativeSpriteEngine, engine);
 	REQUIRE(2);
-	bool isMain = testInternal(thisValue, ref_str_main);
-	int dx = jerry_value_as_uint32(args[0]);
-	int dy = jerry_value_as_uint32(args[1]);
-	(isMain ? oamSetMosaic : oamSetMosaicSub)(BOUND(dx, 0, 15), BOUND(dy, 0, 15));
+	bool byID = !jerry_value_is_null(args[0]);
+	jerry_typedarray_type_t idType = byID ? jerry_get_typedarray_type(args[0]) : JERRY_TYPEDARRAY_INVALID;
+	if (byID) EXPECT(idType == JERRY_TYPEDARRAY_UINT8 || idType == JERRY_TYPEDARRAY_UINT16, Uint8Array | Uint16Array);
+	EXPECT(jerry_get_typedarray_type(args[1]) == JERRY_TYPEDARRAY_INT16, Int16Array);
+
+	int idx = ENGINE_INDEX(engine);
+	jerry_length_t byteOffset, byteLength;
+	u8 *ids = NULL;
+	u32 count = jerry_get_typedarray_length(args[1]) / BATCH_FIELDS;
+	if (byID) {
+		jerry_value_t idBuffer = jerry_get_typedarray_buffer(args[0], &byteOffset, &byteLength);
+		ids = jerry_get_arraybuffer_pointer(idBuffer) + byteOffset;
+		jerry_release_value(idBuffer);
+		u32 idCount = jerry_get_typedarray_length(args[0]);
+		if (idCount < count) count = idCount;
+	}
+	else if (count > (u32) SPRITE_LIMIT(idx)) count = SPRITE_LIMIT(idx);
+	auto idAt = [&](u32 i) -> u32 { return !byID ? i : idType == JERRY_TYPEDARRAY_UINT8 ? ids[i] : ((u16 *) ids)[i]; };
+	jerry_value_t fieldBuffer = jerry_get_typedarray_buffer(args[1], &byteOffset, &byteLength);
+	s16 *fields = (s16 *) (jerry_get_arraybuffer_pointer(fieldBuffer) + byteOffset);
+	jerry_release_value(fieldBuffer);
+
+	NativeSprite **slots = spriteSlots[idx];
+	for (u32 i = 0; i < count; i++) {
+		s16 *field = fields + i * BATCH_FIELDS;
+		if (byID && (idAt(i) >= (u32) SPRITE_LIMIT(idx) || slots[idAt(i)] == NULL)) return RangeError("Sprite ID is not in use.");
+		if (field[5] != -1 && !matrixInUse(engine->main, field[5])) return RangeError("Affine matrix ID is not in use.");
+	}
+
+	SpriteEntry *table = spriteTables[idx];
+	for (u32 i = 0; i < count; i++) {
+		NativeSprite *sprite = slots[idAt(i)];
+		if (sprite == NULL) continue;
+		s16 *field = fields + i * BATCH_FIELDS;
+		SpriteEntry *entry = table + sprite->id;
+		entry->x = field[0];
+		entry->y = field[1];
+		if (sprite->motion != NULL) {
+			sprite->motion->x = field[0] << 8;
+			sprite->motion->y = field[1] << 8;
+		}
+		entry->priority = BOUND(field[2], 0, 3);
+		entry->palette = BOUND(field[3], 0, 15);
+		sprite->affineID = field[5];
+		spriteApplyAffine(sprite, entry, field[4] != 0);
+	}
+	return JS_UNDEFINED;
+}
+
+JS_value SpriteEngine_defragment(NativeSpriteEngine *engine) {
+	if (!gfxAllocators[ENGINE_INDEX(engine)].linear) return Error("Sprite graphics memory can't be defragmented with 2D mapping.");
+	gfxDefragment(ENGINE_INDEX(engine));
+	return JS_UNDEFINED;
+}
+
+void SpriteEngine_commit(NativeSpriteEngine *engine) {
+	spriteCommit(engine->main);
+}
+
+FUNCTION(SpriteEngine_set_sortMode) {
+	NATIVE_THIS(NativeSpriteEngine, engine);
+	REQUIRE(1);
+	char *modeStr = toRawString(args[0]);
+	SpriteSort sort;
+	bool valid = true;
+	if (strcmp(modeStr, "none") == 0) sort = SORT_NONE;
+	else if (strcmp(modeStr, "priority") == 0) sort = SORT_PRIORITY;
+	else if (strcmp(modeStr, "y") == 0) sort = SORT_Y;
+	else if (strcmp(modeStr, "z") == 0) sort = SORT_Z;
+	else valid = false;
+	free(modeStr);
+	if (!valid) return TypeError("Expected a sort mode of 'none', 'priority', 'y', or 'z'.");
+	engine->sort = sort;
 	return JS_UNDEFINED;
 }
+JS_value SpriteEngine_get_sortMode(NativeSpriteEngine *engine) {
+	const char *modes[] = {"none", "priority", "y", "z"};
+	return String(modes[engine->sort]);
+}
+int SpriteEngine_get_droppedSprites(NativeSpriteEngine *engine) {
+	return multiplexers[ENGINE_INDEX(engine)].enabled ? multiplexers[ENGINE_INDEX(engine)].dropped : 0;
+}
+
+void SpriteEngine_setMosaic(NativeSpriteEngine *engine, int dx, int dy) {
+	(engine->main ? oamSetMosaic : oamSetMosaicSub)(BOUND(dx, 0, 15), BOUND(dy, 0, 15));
+}
 
 FUNCTION(SpriteEngine_writeExtendedPalette) {
+	NATIVE_THIS(NativeSpriteEngine, engine);
 	REQUIRE(3); EXPECT(jerry_value_is_typedarray(args[2]), TypedArray);
 	const char disabledMsg[] = "Extended palettes not enabled for this engine.";
 	u32 id = jerry_value_as_uint32(args[0]);
@@ -568,7 +1319,7 @@ FUNCTION(SpriteEngine_writeExtendedPalette) {
 	jerry_release_value(arrayBuffer);
 	if (targetOffset * sizeof(u16) + dataLen > 256 * sizeof(u16)) return RangeError("Data too large, extends out of bounds.");
 
-	if (testInternal(thisValue, ref_str_main)) {
+	if (engine->main) {
 		if ((REG_DISPCNT & DISPLAY_SPR_EXT_PALETTE) == 0) return Error(disabledMsg);
 
 		if (VRAM_F_CR & VRAM_F_SPRITE_EXT_PALETTE) {
@@ -597,37 +1348,114 @@ FUNCTION(SpriteEngine_writeExtendedPalette) {
 	return JS_UNDEFINED;
 }
 
+FUNCTION(SpriteAnimationConstructor) {
+	CONSTRUCTOR(SpriteAnimation); REQUIRE(2);
+	EXPECT(jerry_value_is_array(args[0]), Array);
+	u32 length = jerry_get_array_length(args[0]);
+	if (length == 0 || length > 0xFFFF) return RangeError("Expected between 1 and 65535 frames.");
+	bool durationList = jerry_value_is_array(args[1]);
+	if (durationList && jerry_get_array_length(args[1]) < length) return RangeError("Expected a duration for every frame.");
+
+	AnimationMode mode = ANIMATION_LOOP;
+	if (argCount > 2 && !jerry_value_is_undefined(args[2])) {
+		char *modeStr = toRawString(args[2]);
+		bool valid = true;
+		if (strcmp(modeStr, "once") == 0) mode = ANIMATION_ONCE;
+		else if (strcmp(modeStr, "pingpong") == 0) mode = ANIMATION_PINGPONG;
+		else valid = strcmp(modeStr, "loop") == 0;
+		free(modeStr);
+		if (!valid) return TypeError("Expected an animation mode of 'loop', 'once', or 'pingpong'.");
+	}
+
+	NativeSpriteAnimation *animation = new NativeSpriteAnimation{.main = true, .mode = mode, .frames = {}};
+	animation->frames.reserve(length);
+	for (u32 i = 0; i < length; i++) {
+		jerry_value_t graphicObj = jerry_get_property_by_index(args[0], i);
+		NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(graphicObj);
+		const char *error = NULL;
+		if (graphic == NULL) error = "Expected every frame to be a SpriteGraphic.";
+		else if (graphic->removed) error = WAS_REMOVED;
+		else if (i > 0 && graphic->main != animation->main) error = "Expected every frame to be from the same engine.";
+		else if (i > 0 && (graphic->bpp == 16) != (animation->frames[0].graphic->bpp == 16)) error = "Expected frames to be either all bitmap or all paletted graphics.";
+		if (error != NULL) {
+			jerry_release_value(graphicObj);
+			delete animation;
+			return TypeError(error);
+		}
+		animation->main = graphic->main;
+
+		jerry_value_t durationVal = durationList ? jerry_get_property_by_index(args[1], i) : jerry_acquire_value(args[1]);
+		u32 duration = jerry_value_as_uint32(durationVal);
+		jerry_release_value(durationVal);
+		animation->frames.push_back({.graphic = graphic, .graphicObj = graphicObj, .duration = (u16) (BOUND(duration, 1, 0xFFFF))});
+	}
+	setNative(thisValue, animation);
+	return JS_UNDEFINED;
+}
+
+int SpriteAnimation_get_length(NativeSpriteAnimation *animation) {
+	return animation->frames.size();
+}
+JS_value SpriteAnimation_get_mode(NativeSpriteAnimation *animation) {
+	return String(animation->mode == ANIMATION_ONCE ? "once" : animation->mode == ANIMATION_PINGPONG ? "pingpong" : "loop");
+}
+
 void exposeSpriteAPI(jerry_value_t global) {
-	JS_class Sprite = createClass(global, "Sprite", IllegalConstructor);
-	defGetterSetter(Sprite.prototype, "x", Sprite_get_x, Sprite_set_x);
-	defGetterSetter(Sprite.prototype, "y", Sprite_get_y, Sprite_set_y);
-	setMethod(Sprite.prototype, "setPosition", Sprite_setPosition);
+	jerry_value_t EventTarget = getProperty(global, "EventTarget");
+	jerry_value_t eventTargetPrototype = getProperty(EventTarget, "prototype");
+	JS_class Sprite = extendClass(global, "Sprite", IllegalConstructor, eventTargetPrototype);
+	jerry_release_value(eventTargetPrototype);
+	jerry_release_value(EventTarget);
+	defGetterSetter(Sprite.prototype, "x", bindMethod<Sprite_get_x>, bindMethod<Sprite_set_x>);
+	defGetterSetter(Sprite.prototype, "y", bindMethod<Sprite_get_y>, bindMethod<Sprite_set_y>);
+	setMethod(Sprite.prototype, "setPosition", bindMethod<Sprite_setPosition>);
 	defGetterSetter(Sprite.prototype, "gfx", Sprite_get_gfx, Sprite_set_gfx);
-	defGetterSetter(Sprite.prototype, "priority", Sprite_get_priority, Sprite_set_priority);
-	defGetterSetter(Sprite.prototype, "hidden", Sprite_get_hidden, Sprite_set_hidden);
-	defGetterSetter(Sprite.prototype, "flipH", Sprite_get_flipH, Sprite_set_flipH);
-	defGetterSetter(Sprite.prototype, "flipV", Sprite_get_flipV, Sprite_set_flipV);
-	defGetterSetter(Sprite.prototype, "affine", Sprite_get_affine, Sprite_set_affine);
-	defGetterSetter(Sprite.prototype, "sizeDouble", Sprite_get_sizeDouble, Sprite_set_sizeDouble);
-	defGetterSetter(Sprite.prototype, "mosaic", Sprite_get_mosaic, Sprite_set_mosaic);
-	setMethod(Sprite.prototype, "remove", Sprite_remove);
+	defGetterSetter(Sprite.prototype, "priority", bindMethod<Sprite_get_priority>, bindMethod<Sprite_set_priority>);
+	defGetterSetter(Sprite.prototype, "hidden", bindMethod<Sprite_get_hidden>, bindMethod<Sprite_set_hidden>);
+	defGetterSetter(Sprite.prototype, "flipH", bindMethod<Sprite_get_flipH>, bindMethod<Sprite_set_flipH>);
+	defGetterSetter(Sprite.prototype, "flipV", bindMethod<Sprite_get_flipV>, bindMethod<Sprite_set_flipV>);
+	defGetterSetter(Sprite.prototype, "affine", bindMethod<Sprite_get_affine>, bindMethod<Sprite_set_affine>);
+	defGetterSetter(Sprite.prototype, "sizeDouble", bindMethod<Sprite_get_sizeDouble>, bindMethod<Sprite_set_sizeDouble>);
+	defGetterSetter(Sprite.prototype, "mosaic", bindMethod<Sprite_get_mosaic>, bindMethod<Sprite_set_mosaic>);
+	defGetterSetter(Sprite.prototype, "animation", Sprite_get_animation, Sprite_set_animation);
+	defGetterSetter(Sprite.prototype, "animationFrame", bindMethod<Sprite_get_animationFrame>, bindMethod<Sprite_set_animationFrame>);
+	defGetterSetter(Sprite.prototype, "animationPlaying", bindMethod<Sprite_get_animationPlaying>, bindMethod<Sprite_set_animationPlaying>);
+	setMethod(Sprite.prototype, "remove", bindMethod<Sprite_remove>);
+	defNativeGetterSetter<&NativeSprite::z>(Sprite.prototype, "z");
+	defGetterSetter(Sprite.prototype, "vx", bindMethod<Sprite_get_motion<&SpriteMotion::vx>>, bindMethod<Sprite_set_motion<&SpriteMotion::vx>>);
+	defGetterSetter(Sprite.prototype, "vy", bindMethod<Sprite_get_motion<&SpriteMotion::vy>>, bindMethod<Sprite_set_motion<&SpriteMotion::vy>>);
+	defGetterSetter(Sprite.prototype, "ax", bindMethod<Sprite_get_motion<&SpriteMotion::ax>>, bindMethod<Sprite_set_motion<&SpriteMotion::ax>>);
+	defGetterSetter(Sprite.prototype, "ay", bindMethod<Sprite_get_motion<&SpriteMotion::ay>>, bindMethod<Sprite_set_motion<&SpriteMotion::ay>>);
+	defGetterSetter(Sprite.prototype, "friction", bindMethod<Sprite_get_motion<&SpriteMotion::friction>>, bindMethod<Sprite_set_friction>);
+	setMethod(Sprite.prototype, "setBounds", Sprite_setBounds);
+	setMethod(Sprite.prototype, "stop", bindMethod<Sprite_stop>);
+	defNativeGetter<&NativeSprite::id>(Sprite.prototype, "id");
+	defNativeGetter<&NativeSprite::main>(Sprite.prototype, "main");
 	JS_class PalettedSprite = extendClass(global, "PalettedSprite", IllegalConstructor, Sprite.prototype);
-	defGetterSetter(PalettedSprite.prototype, "palette", Sprite_get_palette, Sprite_set_palette);
+	defGetterSetter(PalettedSprite.prototype, "palette", bindMethod<Sprite_get_palette>, bindMethod<Sprite_set_palette>);
 	ref_PalettedSprite = PalettedSprite;
 	JS_class BitmapSprite = extendClass(global, "BitmapSprite", IllegalConstructor, Sprite.prototype);
-	defGetterSetter(BitmapSprite.prototype, "alpha", Sprite_get_palette, Sprite_set_palette);
+	defGetterSetter(BitmapSprite.prototype, "alpha", bindMethod<Sprite_get_palette>, bindMethod<Sprite_set_palette>);
 	ref_BitmapSprite = BitmapSprite;
 	jerry_value_t SpriteEngine = jerry_create_object();
-	setMethod(SpriteEngine, "init", SpriteEngine_init);
-	setMethod(SpriteEngine, "enable", SpriteEngine_enable);
-	setMethod(SpriteEngine, "disable", SpriteEngine_disable);
-	setMethod(SpriteEngine, "addSprite", SpriteEngine_addSprite);
+	setMethod(SpriteEngine, "init", bindMethod<SpriteEngine_init>);
+	setMethod(SpriteEngine, "enable", bindMethod<SpriteEngine_enable>);
+	setMethod(SpriteEngine, "disable", bindMethod<SpriteEngine_disable>);
+	setMethod(SpriteEngine, "addSprite", bindMethod<SpriteEngine_addSprite>);
 	setMethod(SpriteEngine, "addGraphic", SpriteEngine_addGraphic);
-	setMethod(SpriteEngine, "addAffineMatrix", SpriteEngine_addAffineMatrix);
-	setMethod(SpriteEngine, "setMosaic", SpriteEngine_setMosaic);
+	setMethod(SpriteEngine, "loadGraphic", SpriteEngine_loadGraphic);
+	setMethod(SpriteEngine, "loadSheet", SpriteEngine_loadSheet);
+	setMethod(SpriteEngine, "addAffineMatrix", bindMethod<SpriteEngine_addAffineMatrix>);
+	setMethod(SpriteEngine, "updateBatch", SpriteEngine_updateBatch);
+	setMethod(SpriteEngine, "setMosaic", bindMethod<SpriteEngine_setMosaic>);
+	setMethod(SpriteEngine, "commit", bindMethod<SpriteEngine_commit>);
+	setMethod(SpriteEngine, "defragment", bindMethod<SpriteEngine_defragment>);
+	defNativeGetterSetter<&NativeSpriteEngine::autoCommit>(SpriteEngine, "autoCommit");
+	defGetterSetter(SpriteEngine, "sortMode", bindMethod<SpriteEngine_get_sortMode>, SpriteEngine_set_sortMode);
+	defGetter(SpriteEngine, "droppedSprites", bindMethod<SpriteEngine_get_droppedSprites>);
 	setMethod(SpriteEngine, "writeExtendedPalette", SpriteEngine_writeExtendedPalette);
 	jerry_value_t main = createObject(Sprite.constructor, "main");
-	jerry_set_internal_property(main, ref_str_main, JS_TRUE);
+	spriteEngines[0] = setNative(main, new NativeSpriteEngine{.main = true, .autoCommit = true, .sort = SORT_NONE});
 	jerry_value_t mainSpritePaletteArrayBuffer = jerry_create_arraybuffer_external(256 * sizeof(u16), (u8*) SPRITE_PALETTE, [](void * _){});
 	jerry_value_t mainSpritePaletteTypedArray = jerry_create_typedarray_for_arraybuffer_sz(JERRY_TYPEDARRAY_UINT16, mainSpritePaletteArrayBuffer, 0, 256);
 	defReadonly(main, "palette", mainSpritePaletteTypedArray);
@@ -636,7 +1464,7 @@ void exposeSpriteAPI(jerry_value_t global) {
 	setPrototype(main, SpriteEngine);
 	jerry_release_value(main);
 	jerry_value_t sub = createObject(Sprite.constructor, "sub");
-	jerry_set_internal_property(sub, ref_str_main, JS_FALSE);
+	spriteEngines[1] = setNative(sub, new NativeSpriteEngine{.main = false, .autoCommit = true, .sort = SORT_NONE});
 	jerry_value_t subSpritePaletteArrayBuffer = jerry_create_arraybuffer_external(256 * sizeof(u16), (u8*) SPRITE_PALETTE_SUB, [](void * _){});
 	jerry_value_t subSpritePaletteTypedArray = jerry_create_typedarray_for_arraybuffer_sz(JERRY_TYPEDARRAY_UINT16, subSpritePaletteArrayBuffer, 0, 256);
 	defReadonly(sub, "palette", subSpritePaletteTypedArray);
@@ -646,27 +1474,56 @@ void exposeSpriteAPI(jerry_value_t global) {
 	jerry_release_value(sub);
 	jerry_release_value(SpriteEngine);
 	ref_Sprite = Sprite;
+	spriteTables[0] = oamMain.oamMemory;
+	spriteTables[1] = oamSub.oamMemory;
+	irqSet(IRQ_VBLANK, spriteVBlank);
 
 	JS_class SpriteGraphic = createClass(global, "SpriteGraphic", IllegalConstructor);
-	defGetter(SpriteGraphic.prototype, "width", SpriteGraphic_get_width);
-	defGetter(SpriteGraphic.prototype, "height", SpriteGraphic_get_height);
-	setMethod(SpriteGraphic.prototype, "remove", SpriteGraphic_remove);
+	defNativeGetter<&NativeSpriteGraphic::bpp>(SpriteGraphic.prototype, "colorFormat");
+	defNativeGetter<&NativeSpriteGraphic::width>(SpriteGraphic.prototype, "width");
+	defNativeGetter<&NativeSpriteGraphic::height>(SpriteGraphic.prototype, "height");
+	defNativeGetter<&NativeSpriteGraphic::main>(SpriteGraphic.prototype, "main");
+	defGetter(SpriteGraphic.prototype, "data", SpriteGraphic_get_data);
+	defNativeGetterSetter<&NativeSpriteGraphic::touchMask>(SpriteGraphic.prototype, "touchMask");
+	setMethod(SpriteGraphic.prototype, "remove", bindMethod<SpriteGraphic_remove>);
 	ref_SpriteGraphic = SpriteGraphic;
 
 	JS_class SpriteAffineMatrix = createClass(global, "SpriteAffineMatrix", IllegalConstructor);
-	defGetterSetter(SpriteAffineMatrix.prototype, "hdx", SpriteAffineMatrix_get_hdx, SpriteAffineMatrix_set_hdx);
-	defGetterSetter(SpriteAffineMatrix.prototype, "hdy", SpriteAffineMatrix_get_hdy, SpriteAffineMatrix_set_hdy);
-	defGetterSetter(SpriteAffineMatrix.prototype, "vdx", SpriteAffineMatrix_get_vdx, SpriteAffineMatrix_set_vdx);
-	defGetterSetter(SpriteAffineMatrix.prototype, "vdy", SpriteAffineMatrix_get_vdy, SpriteAffineMatrix_set_vdy);
-	setMethod(SpriteAffineMatrix.prototype, "rotateScale", SpriteAffineMatrix_rotateScale);
-	setMethod(SpriteAffineMatrix.prototype, "remove", SpriteAffineMatrix_remove);
+	defGetterSetter(SpriteAffineMatrix.prototype, "hdx", bindMethod<SpriteAffineMatrix_get_hdx>, bindMethod<SpriteAffineMatrix_set_hdx>);
+	defGetterSetter(SpriteAffineMatrix.prototype, "hdy", bindMethod<SpriteAffineMatrix_get_hdy>, bindMethod<SpriteAffineMatrix_set_hdy>);
+	defGetterSetter(SpriteAffineMatrix.prototype, "vdx", bindMethod<SpriteAffineMatrix_get_vdx>, bindMethod<SpriteAffineMatrix_set_vdx>);
+	defGetterSetter(SpriteAffineMatrix.prototype, "vdy", bindMethod<SpriteAffineMatrix_get_vdy>, bindMethod<SpriteAffineMatrix_set_vdy>);
+	setMethod(SpriteAffineMatrix.prototype, "rotateScale", bindMethod<SpriteAffineMatrix_rotateScale>);
+	setMethod(SpriteAffineMatrix.prototype, "remove", bindMethod<SpriteAffineMatrix_remove>);
+	defNativeGetter<&NativeSpriteAffineMatrix::id>(SpriteAffineMatrix.prototype, "id");
+	defNativeGetter<&NativeSpriteAffineMatrix::main>(SpriteAffineMatrix.prototype, "main");
 	ref_SpriteAffineMatrix = SpriteAffineMatrix;
+
+	JS_class SpriteAnimation = createClass(global, "SpriteAnimation", SpriteAnimationConstructor);
+	defGetter(SpriteAnimation.prototype, "length", bindMethod<SpriteAnimation_get_length>);
+	defGetter(SpriteAnimation.prototype, "mode", bindMethod<SpriteAnimation_get_mode>);
+	defNativeGetter<&NativeSpriteAnimation::main>(SpriteAnimation.prototype, "main");
+	ref_SpriteAnimation = SpriteAnimation;
 }
 
 void releaseSpriteReferences() {
+	multiplexSetEnabled(0, false);
+	multiplexSetEnabled(1, false);
+	irqSet(IRQ_VBLANK, NULL);
+	commitPending[0] = commitPending[1] = false;
+	for (int idx = 0; idx < 2; idx++) {
+		for (NativeSprite *sprite : spriteSlots[idx]) {
+			if (sprite != NULL) spriteFreeSlot(sprite);
+		}
+	}
+	for (int i = 0; i < MATRIX_COUNT; i++) {
+		if (spriteUsage[i] & USAGE_MATRIX_MAIN) jerry_release_value(matrixSlots[0][i]);
+		if (spriteUsage[i] & USAGE_MATRIX_SUB) jerry_release_value(matrixSlots[1][i]);
+	}
 	releaseClass(ref_Sprite);
 	releaseClass(ref_PalettedSprite);
 	releaseClass(ref_BitmapSprite);
 	releaseClass(ref_SpriteGraphic);
 	releaseClass(ref_SpriteAffineMatrix);
+	releaseClass(ref_SpriteAnimation);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ extern "C" {
 #include <string.h>
 
 #include "event.hpp"
+#include "sprite.hpp"
 #include "util/helpers.hpp"
 
 
@@ -34,7 +35,11 @@ void queueButtonEvents(bool down) {
 }
 
 u16 prevX = 0, prevY = 0;
+// The sprite a touch started on, which gets the rest of its events too
+jerry_value_t touchTarget = JS_UNDEFINED;
 void queueTouchEvent(const char *name, int curX, int curY, bool usePrev) {
+	bool toGlobal = dependentEvents & (touchstart | touchmove | touchend);
+	if (!toGlobal && jerry_value_is_undefined(touchTarget)) return;
 	jerry_value_t touchEvent = createEvent(name, false);
 	defReadonly(touchEvent, "x", (double) curX);
 	defReadonly(touchEvent, "y", (double) curY);
@@ -44,18 +49,28 @@ void queueTouchEvent(const char *name, int curX, int curY, bool usePrev) {
 	defReadonly(touchEvent, "dy", dyNum);
 	jerry_release_value(dxNum);
 	jerry_release_value(dyNum);
-	queueEvent(ref_global, touchEvent);
+	if (!jerry_value_is_undefined(touchTarget)) queueEvent(touchTarget, touchEvent);
+	if (toGlobal) queueEvent(ref_global, touchEvent);
 	jerry_release_value(touchEvent);
 }
 
 void queueTouchEvents() {
 	touchPosition pos;
 	touchRead(&pos);
-	if (keysDown() & KEY_TOUCH) queueTouchEvent("touchstart", pos.px, pos.py, false);
+	if (keysDown() & KEY_TOUCH) {
+		jerry_release_value(touchTarget);
+		NativeSprite *sprite = spriteTouchTarget(pos.px, pos.py);
+		touchTarget = sprite == NULL ? JS_UNDEFINED : jerry_acquire_value(sprite->object);
+		queueTouchEvent("touchstart", pos.px, pos.py, false);
+	}
 	else if (keysHeld() & KEY_TOUCH) {
 		if (prevX != pos.px || prevY != pos.py) queueTouchEvent("touchmove", pos.px, pos.py, true);
 	}
-	else if (keysUp() & KEY_TOUCH) queueTouchEvent("touchend", prevX, prevY, false);
+	else if (keysUp() & KEY_TOUCH) {
+		queueTouchEvent("touchend", prevX, prevY, false);
+		jerry_release_value(touchTarget);
+		touchTarget = JS_UNDEFINED;
+	}
 	prevX = pos.px;
 	prevY = pos.py;
 }
@@ -176,4 +191,9 @@ void exposeSystemAPI(jerry_value_t global) {
 	defGetter(Touch, "end", RETURN(jerry_create_boolean(keysUp() & KEY_TOUCH)));
 	setMethod(Touch, "getPosition", DS_touchGetPosition);
 	jerry_release_value(Touch);
+}
+
+void releaseSystemReferences() {
+	jerry_release_value(touchTarget);
+	touchTarget = JS_UNDEFINED;
 }
\ No newline at end of file
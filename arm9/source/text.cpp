@@ -0,0 +1,283 @@
+#include "text.hpp"
+
+#include <stdlib.h>
+
+#include "bitmap.hpp"
+#include "io/console.hpp"
+#include "sprite.hpp"
+#include "util/color.hpp"
+#include "util/font.hpp"
+#include "util/helpers.hpp"
+
+
+
+JS_class ref_Font;
+const u32 WIDTH_CACHE_SIZE = 128;
+
+// only fonts loaded from files own their data, built-in fonts are resident
+void onFontFree(void *fontPtr) {
+	NitroFont *font = (NitroFont *) fontPtr;
+	if (font->stream) fontFree(*font);
+	delete font;
+}
+jerry_object_native_info_t fontNativeInfo = {.free_cb = onFontFree};
+
+inline NitroFont *getFont(jerry_value_t obj) {
+	NitroFont *font = NULL;
+	jerry_get_object_native_pointer(obj, (void **) &font, &fontNativeInfo);
+	return font;
+}
+
+// Measured widths are kept in a prototype-less object keyed by the measured string.
+void resetWidthCache(jerry_value_t fontObj) {
+	jerry_value_t widthCacheObj = jerry_create_object();
+	setPrototype(widthCacheObj, JS_NULL);
+	setInternal(fontObj, "widths", widthCacheObj);
+	jerry_release_value(widthCacheObj);
+	setInternal(fontObj, "widthCount", 0.0);
+}
+
+// Calls handler(codepoint) on each codepoint of a string value.
+template <typename Handler>
+void forEachCodepoint(jerry_value_t string, Handler handler) {
+	forEachStringChunk(string, [&](const char *chunk, jerry_size_t size) {
+		const u8 *ptr = (const u8 *) chunk, *end = ptr + size;
+		while (ptr < end) {
+			char16_t codepoint;
+			if (ptr[0] < 0x80) codepoint = *(ptr++);
+			else if (ptr[0] < 0xE0) {
+				codepoint = (ptr[0] & 0b11111) << 6 | (ptr[1] & 0b111111);
+				ptr += 2;
+			}
+			else if (ptr[0] < 0xF0) {
+				codepoint = (ptr[0] & 0b1111) << 12 | (ptr[1] & 0b111111) << 6 | (ptr[2] & 0b111111);
+				ptr += 3;
+			}
+			else {
+				codepoint = REPLACEMENT_CHAR; // outside of what NitroFont can map
+				ptr += 4;
+			}
+			handler(codepoint);
+		}
+	});
+}
+
+// Width of the longest line of text.
+u32 measureText(const NitroFont &font, jerry_value_t text) {
+	u32 width = 0, lineWidth = 0;
+	forEachCodepoint(text, [&](char16_t codepoint) {
+		if (codepoint == '\n') {
+			if (lineWidth > width) width = lineWidth;
+			lineWidth = 0;
+		}
+		else lineWidth += fontGetCodePointWidth(font, codepoint);
+	});
+	return lineWidth > width ? lineWidth : width;
+}
+
+/* Pixel buffer that text can be drawn into.
+ * Paletted buffers are either linear or laid out in 8x8 tiles, like sprite graphics in 1D mapping.
+ */
+struct DrawTarget {
+	u8 *data;
+	u32 width;
+	u32 height;
+	u8 bpp;
+	bool tiled;
+};
+
+bool getDrawTarget(jerry_value_t value, DrawTarget *target) {
+	NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(value);
+	if (graphic != NULL) {
+		target->data = (u8 *) graphic->gfx;
+		target->width = graphic->width;
+		target->height = graphic->height;
+		target->bpp = graphic->bpp;
+		target->tiled = target->bpp != 16;
+		return true;
+	}
+	NativeBitmap *bitmap = getNative<NativeBitmap>(value);
+	if (bitmap != NULL) {
+		target->data = bitmap->pixels;
+		target->width = bitmap->width;
+		target->height = bitmap->height;
+		target->bpp = bitmap->bpp;
+		target->tiled = false;
+		return true;
+	}
+	if (!jerry_value_is_typedarray(value)) return false;
+
+	// the width of a bitmap background
+	jerry_typedarray_type_t type = jerry_get_typedarray_type(value);
+	if (type == JERRY_TYPEDARRAY_UINT16) target->bpp = 16;
+	else if (type == JERRY_TYPEDARRAY_UINT8 || type == JERRY_TYPEDARRAY_UINT8CLAMPED) target->bpp = 8;
+	else return false;
+	target->width = 256;
+	target->height = jerry_get_typedarray_length(value) / 256;
+	target->tiled = false;
+
+	jerry_length_t byteOffset, byteLength;
+	jerry_value_t arrayBuffer = jerry_get_typedarray_buffer(value, &byteOffset, &byteLength);
+	target->data = jerry_get_arraybuffer_pointer(arrayBuffer) + byteOffset;
+	jerry_release_value(arrayBuffer);
+	return target->data != NULL && byteLength >= target->width * target->height * target->bpp / 8;
+}
+
+// VRAM can't be written to a byte at a time, so paletted pixels are set a halfword at a time.
+void plotPixel(const DrawTarget &target, s32 x, s32 y, u16 color) {
+	if (x < 0 || y < 0 || (u32) x >= target.width || (u32) y >= target.height) return;
+	if (target.bpp == 16) {
+		((u16 *) target.data)[x + y * target.width] = color;
+		return;
+	}
+	u32 index = target.tiled
+		? ((y / 8) * (target.width / 8) + x / 8) * 64 + (y % 8) * 8 + x % 8
+		: x + y * target.width;
+	if (target.bpp == 4) {
+		u16 *halfword = (u16 *) (target.data + (index / 4) * 2);
+		u8 shift = (index % 4) * 4;
+		*halfword = (*halfword & ~(0xF << shift)) | (color & 0xF) << shift;
+	}
+	else if ((uintptr_t) target.data & 1) target.data[index] = color; // unaligned, can't be VRAM
+	else {
+		u16 *halfword = (u16 *) (target.data + (index & ~1));
+		u8 shift = (index & 1) * 8;
+		*halfword = (*halfword & ~(0xFF << shift)) | (color & 0xFF) << shift;
+	}
+}
+
+u16 toColor(jerry_value_t value, u16 noneColor) {
+	if (!jerry_value_is_string(value)) return jerry_value_as_uint32(value);
+	char *colorDesc = rawString(value);
+	u16 color = colorParse(colorDesc, noneColor);
+	free(colorDesc);
+	return color;
+}
+
+/* Reads a palette for the font's four shades: background, two blend levels, and text color.
+ * Takes either a list of up to four colors (or palette indices), or a single text color.
+ */
+void getTextPalette(jerry_value_t value, u8 bpp, u16 *palette) {
+	if (jerry_value_is_undefined(value)) {
+		palette[0] = palette[1] = 0;
+		palette[2] = palette[3] = bpp == 16 ? 0xFFFF : 1;
+	}
+	else if (jerry_value_is_object(value)) {
+		for (u32 i = 0; i < 4; i++) {
+			jerry_value_t colorVal = jerry_get_property_by_index(value, i);
+			palette[i] = jerry_value_is_undefined(colorVal) ? 0 : toColor(colorVal, 0);
+			jerry_release_value(colorVal);
+		}
+	}
+	else {
+		palette[0] = palette[1] = 0;
+		palette[2] = palette[3] = toColor(value, 0);
+	}
+}
+
+
+
+FUNCTION(FontConstructor) {
+	CONSTRUCTOR(Font); REQUIRE(1);
+	char *path = toRawString(args[0]);
+	NitroFont font = fontLoadFile(path);
+	free(path);
+	if (font.charMap == NULL) return Error("Unable to load font.");
+	jerry_set_object_native_pointer(thisValue, new NitroFont(font), &fontNativeInfo);
+	resetWidthCache(thisValue);
+	return JS_UNDEFINED;
+}
+
+FUNCTION(Font_get_height) {
+	NitroFont *font = getFont(thisValue);
+	EXPECT(font != NULL, Font);
+	return jerry_create_number(font->tileHeight);
+}
+
+FUNCTION(Font_measure) {
+	REQUIRE(1);
+	NitroFont *font = getFont(thisValue);
+	EXPECT(font != NULL, Font);
+	jerry_value_t textStr = jerry_value_to_string(args[0]);
+	jerry_value_t widthCacheObj = getInternal(thisValue, "widths");
+	jerry_value_t widthNum = jerry_get_property(widthCacheObj, textStr);
+	if (!jerry_value_is_number(widthNum)) {
+		jerry_release_value(widthNum);
+		widthNum = jerry_create_number(measureText(*font, textStr));
+
+		jerry_value_t widthCountNum = getInternal(thisValue, "widthCount");
+		u32 widthCount = jerry_value_as_uint32(widthCountNum);
+		jerry_release_value(widthCountNum);
+		if (widthCount >= WIDTH_CACHE_SIZE) { // start over once the cache fills up
+			jerry_release_value(widthCacheObj);
+			resetWidthCache(thisValue);
+			widthCacheObj = getInternal(thisValue, "widths");
+			widthCount = 0;
+		}
+		jerry_release_value(jerry_set_property(widthCacheObj, textStr, widthNum));
+		setInternal(thisValue, "widthCount", (double) widthCount + 1);
+	}
+	jerry_release_value(widthCacheObj);
+	jerry_release_value(textStr);
+	return widthNum;
+}
+
+FUNCTION(Font_drawText) {
+	REQUIRE(4);
+	NitroFont *font = getFont(thisValue);
+	EXPECT(font != NULL, Font);
+	DrawTarget target;
+	NativeSpriteGraphic *graphic = getNative<NativeSpriteGraphic>(args[0]);
+	if (graphic != NULL && graphic->removed) return TypeError(WAS_REMOVED);
+	if (!getDrawTarget(args[0], &target)) return TypeError("Expected a SpriteGraphic, Bitmap, Uint8Array, or Uint16Array to draw to.");
+	NativeBitmap *bitmap = getNative<NativeBitmap>(args[0]);
+	s32 x = jerry_value_as_int32(args[1]);
+	s32 y = jerry_value_as_int32(args[2]);
+	u16 palette[4];
+	getTextPalette(argCount > 4 ? args[4] : JS_UNDEFINED, target.bpp, palette);
+
+	jerry_value_t textStr = jerry_value_to_string(args[3]);
+	s32 penX = x, penY = y;
+	u32 width = 0;
+	forEachCodepoint(textStr, [&](char16_t codepoint) {
+		if (codepoint == '\n') {
+			penX = x;
+			penY += font->tileHeight;
+			return;
+		}
+		const u8 *widths = NULL;
+		const u8 *tile = fontGetGlyph(*font, codepoint, &widths);
+		if (tile == NULL) return;
+		for (u8 ty = 0; ty < font->tileHeight; ty++) {
+			if (palette[0]) for (u8 tx = 0; tx < widths[0]; tx++) plotPixel(target, penX + tx, penY + ty, palette[0]);
+			for (u16 tx = 0, pixel = ty * font->tileWidth; tx < widths[1]; tx++, pixel++) {
+				u16 color = palette[tile[pixel / 4] >> ((3 - pixel % 4) * 2) & 0b11];
+				if (color) plotPixel(target, penX + widths[0] + tx, penY + ty, color);
+			}
+		}
+		if (bitmap != NULL) markDirty(bitmap, penX, penY, widths[2], font->tileHeight);
+		penX += widths[2];
+		if ((u32) (penX - x) > width) width = penX - x;
+	});
+	jerry_release_value(textStr);
+	return jerry_create_number(width);
+}
+
+void exposeTextAPI(jerry_value_t global) {
+	JS_class Font = createClass(global, "Font", FontConstructor);
+	defGetter(Font.prototype, "height", Font_get_height);
+	setMethod(Font.prototype, "measure", Font_measure);
+	setMethod(Font.prototype, "drawText", Font_drawText);
+
+	jerry_value_t defaultFontObj = jerry_create_object();
+	setPrototype(defaultFontObj, Font.prototype);
+	jerry_set_object_native_pointer(defaultFontObj, new NitroFont(consoleGetFont()), &fontNativeInfo);
+	resetWidthCache(defaultFontObj);
+	defReadonly(Font.constructor, "default", defaultFontObj);
+	jerry_release_value(defaultFontObj);
+	ref_Font = Font;
+}
+
+void releaseTextReferences() {
+	releaseClass(ref_Font);
+}
\ No newline at end of file
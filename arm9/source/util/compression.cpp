@@ -0,0 +1,32 @@
+#include "util/compression.hpp"
+
+#include <nds/arm9/decompress.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+u32 decompressedSize(const u8 *data, u32 size) {
+	if (size < 4) return 0;
+	u8 type = data[0] & 0xF0;
+	if (type == COMPRESSION_HUFFMAN && (data[0] & 0xF) != 4 && (data[0] & 0xF) != 8) return 0;
+	if (type != COMPRESSION_LZ77 && type != COMPRESSION_HUFFMAN && type != COMPRESSION_RLE) return 0;
+	return data[1] | data[2] << 8 | data[3] << 16;
+}
+
+// The BIOS reads the header as a word, so unaligned data is decompressed from an aligned copy.
+bool decompressVram(const u8 *data, u32 size, void *dst) {
+	u8 *copy = NULL;
+	if ((uintptr_t) data & 3) {
+		copy = (u8 *) malloc(size);
+		if (copy == NULL) return false;
+		memcpy(copy, data, size);
+		data = copy;
+	}
+	u8 type = data[0] & 0xF0;
+	if (type == COMPRESSION_LZ77) decompress(data, dst, LZ77Vram);
+	else if (type == COMPRESSION_RLE) decompress(data, dst, RLEVram);
+	else decompress(data, dst, HUFF); // writes whole words, which VRAM accepts
+	free(copy);
+	return true;
+}
\ No newline at end of file
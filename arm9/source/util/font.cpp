@@ -1,5 +1,6 @@
 #include "util/font.hpp"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -11,6 +12,95 @@
 
 
 
+// Calls map(codepoint, tileNum) for every codepoint in a single CMAP block.
+template <typename Map>
+void mapBlock(const u8 *cmap, Map map) {
+	char16_t firstCodepoint = getU16(cmap, 0x08);
+	char16_t lastCodepoint = getU16(cmap, 0x0A);
+	switch (getU32(cmap, 0x0C)) {
+		case 0: {
+			u16 tileNum = getU16(cmap, 0x14);
+			for (u32 codepoint = firstCodepoint; codepoint <= lastCodepoint; codepoint++) {
+				map(codepoint, tileNum++);
+			}
+		} break;
+		case 1: {
+			const u16 *tileNumPtr = (const u16 *)(cmap + 0x14);
+			for (u32 codepoint = firstCodepoint; codepoint <= lastCodepoint; codepoint++) {
+				u16 tileNum = *(tileNumPtr++);
+				if (tileNum != NO_TILE) map(codepoint, tileNum);
+			}
+		} break;
+		case 2: {
+			u16 pairs = getU16(cmap, 0x14);
+			const u8 *pairData = cmap + 0x16;
+			while (pairs--) {
+				map(getU16(pairData, 0), getU16(pairData, 0x2));
+				pairData += 4;
+			}
+		} break;
+	}
+}
+
+// Builds a two-level charMap out of every CMAP block given by walk(map).
+template <typename Walk>
+u16 *buildCharMap(Walk walk) {
+	// find which pages of the codepoint range are used, then fill just those in
+	u16 pageIndex[CHAR_PAGE_COUNT] = {0};
+	u16 pageCount = 1; // page 0 is shared by every empty page
+	walk([&](char16_t codepoint, u16 tileNum) {
+		if (pageIndex[codepoint / CHAR_PAGE_SIZE] == 0) pageIndex[codepoint / CHAR_PAGE_SIZE] = pageCount++;
+	});
+	u16 *charMap = (u16 *) malloc((CHAR_PAGE_COUNT + pageCount * CHAR_PAGE_SIZE) * sizeof(u16));
+	for (u32 i = 0; i < CHAR_PAGE_COUNT; i++) charMap[i] = pageIndex[i];
+	u16 *pages = charMap + CHAR_PAGE_COUNT;
+	memset16(pages, NO_TILE, pageCount * CHAR_PAGE_SIZE);
+	walk([&](char16_t codepoint, u16 tileNum) {
+		pages[pageIndex[codepoint / CHAR_PAGE_SIZE] * CHAR_PAGE_SIZE + codepoint % CHAR_PAGE_SIZE] = tileNum;
+	});
+	return charMap;
+}
+
+// Looks up a codepoint's tile in the two-level map, falling back to the replacement character.
+inline u16 getTileNum(const NitroFont &font, char16_t codepoint) {
+	const u16 *pages = font.charMap + CHAR_PAGE_COUNT;
+	u16 tileNum = pages[font.charMap[codepoint / CHAR_PAGE_SIZE] * CHAR_PAGE_SIZE + codepoint % CHAR_PAGE_SIZE];
+	if (tileNum == NO_TILE && font.replace) {
+		tileNum = pages[font.charMap[REPLACEMENT_CHAR / CHAR_PAGE_SIZE] * CHAR_PAGE_SIZE + REPLACEMENT_CHAR % CHAR_PAGE_SIZE];
+	}
+	return tileNum;
+}
+
+// Returns a tile's graphics, reading its glyph page from the file first if the font is streamed. NULL if unavailable.
+const u8 *getTile(const NitroFont &font, u16 tileNum) {
+	if (font.tileData) return font.tileData + tileNum * font.tileSize;
+	NitroFontStream *stream = font.stream;
+	if (!stream || tileNum >= stream->tileCount) return NULL;
+
+	u16 page = tileNum / GLYPH_PAGE_TILES;
+	u8 slot = 0;
+	bool loaded = false;
+	for (u8 i = 0; i < GLYPH_CACHE_PAGES; i++) {
+		if (stream->pageNums[i] == page) {
+			slot = i;
+			loaded = true;
+			break;
+		}
+		if (stream->lastUsed[i] < stream->lastUsed[slot]) slot = i;
+	}
+	u8 *pageData = stream->pages + slot * GLYPH_PAGE_TILES * font.tileSize;
+	if (!loaded) {
+		fseek(stream->file, stream->tileDataOffset + page * GLYPH_PAGE_TILES * font.tileSize, SEEK_SET);
+		if (fread(pageData, font.tileSize, GLYPH_PAGE_TILES, stream->file) == 0) {
+			stream->pageNums[slot] = NO_TILE;
+			return NULL;
+		}
+		stream->pageNums[slot] = page;
+	}
+	stream->lastUsed[slot] = ++stream->useCount;
+	return pageData + tileNum % GLYPH_PAGE_TILES * font.tileSize;
+}
+
 NitroFont fontLoad(const u8 *data) {
 	NitroFont font;
 
@@ -25,71 +115,155 @@ NitroFont fontLoad(const u8 *data) {
 	font.tileHeight = cglp[0x09];
 	font.tileSize = getU16(cglp, 0x0A);
 
-	u32 tileDataSize = getU32(cglp, 0x04) - 0x10;
-	font.tileData = (u8 *) malloc(tileDataSize);
-	memcpy(font.tileData, cglp + 0x10, tileDataSize);
+	font.tileData = cglp + 0x10;
+	font.widthData = cwdh + 0x10;
+	font.stream = NULL;
 
-	u32 widthDataSize = getU32(cwdh, 0x04) - 0x10;
-	font.widthData = (u8 *) malloc(widthDataSize);
-	memcpy(font.widthData, cwdh + 0x10, widthDataSize);
-	
-	font.charMap = (u16 *) malloc(CHAR_RANGE * sizeof(u16));
-	for (u32 i = 0; i < CHAR_RANGE; i++) font.charMap[i] = NO_TILE;
-	u32 nextCMAP = getU32(finf, 0x18);
-	while (nextCMAP) {
-		const u8 *cmap = data + nextCMAP - 8;
-		char16_t firstCodepoint = getU16(cmap, 0x08);
-		char16_t lastCodepoint = getU16(cmap, 0x0A);
-		switch (getU32(cmap, 0x0C)) {
-			case 0: {
-				u16 tileNum = getU16(cmap, 0x14);
-				for (char16_t codepoint = firstCodepoint; codepoint <= lastCodepoint; codepoint++) {
-					font.charMap[codepoint] = tileNum++;
-				}
-			} break;
-			case 1: {
-				u16 *tileNumPtr = (u16 *)(cmap + 0x14);
-				for (char16_t codepoint = firstCodepoint; codepoint <= lastCodepoint; codepoint++) {
-					font.charMap[codepoint] = *(tileNumPtr++);
-				}
-			} break;
-			case 2: {
-				u16 pairs = getU16(cmap, 0x14);
-				const u8 *pairData = cmap + 0x16;
-				while (pairs--) {
-					font.charMap[getU16(pairData, 0)] = getU16(pairData, 0x2);
-					pairData += 4;
-				}
-			} break;
+	font.charMap = buildCharMap([&](auto map) {
+		for (u32 offset = getU32(finf, 0x18); offset; offset = getU32(data + offset - 8, 0x10)) {
+			mapBlock(data + offset - 8, map);
+		}
+	});
+	font.replace = false;
+	font.replace = getTileNum(font, REPLACEMENT_CHAR) != NO_TILE;
+
+	return font;
+}
+
+NitroFont fontLoadFile(const char *path) {
+	NitroFont font = {0};
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) return font;
+
+	u8 header[0x10], finf[0x1C], cglp[0x10], cwdh[0x10];
+	if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "RTFN", 4) != 0
+	 || fseek(file, getU16(header, 0x0C), SEEK_SET) != 0 || fread(finf, 1, sizeof(finf), file) != sizeof(finf)
+	 || fseek(file, getU32(finf, 0x10) - 8, SEEK_SET) != 0 || fread(cglp, 1, sizeof(cglp), file) != sizeof(cglp)
+	 || fseek(file, getU32(finf, 0x14) - 8, SEEK_SET) != 0 || fread(cwdh, 1, sizeof(cwdh), file) != sizeof(cwdh)) {
+		fclose(file);
+		return font;
+	}
+
+	font.encoding = finf[0x0F];
+	font.bitdepth = cglp[0x0E];
+
+	font.tileWidth = cglp[0x08];
+	font.tileHeight = cglp[0x09];
+	font.tileSize = getU16(cglp, 0x0A);
+
+	// widths are read to their tile numbers' places, so tiles before the first one in CWDH are left with no width
+	u16 firstTile = getU16(cwdh, 0x08), lastTile = getU16(cwdh, 0x0A);
+	u32 widthCount = lastTile >= firstTile ? lastTile - firstTile + 1 : 0;
+	u32 tileCount = font.tileSize == 0 || getU32(cglp, 0x04) < 0x10 ? 0 : (getU32(cglp, 0x04) - 0x10) / font.tileSize;
+	if (widthCount == 0 || tileCount == 0 || getU32(cwdh, 0x04) < 0x10 + widthCount * 3) {
+		fclose(file);
+		return font;
+	}
+	u8 *widthData = (u8 *) calloc(lastTile + 1, 3);
+	if (fread(widthData + firstTile * 3, 3, widthCount, file) != widthCount) {
+		free(widthData);
+		fclose(file);
+		return font;
+	}
+	// tile numbers past the last width or glyph are left out of the map
+	u32 validTiles = lastTile + 1u < tileCount ? lastTile + 1u : tileCount;
+
+	// read every CMAP block into one buffer, back to back
+	u8 *cmaps = NULL;
+	u32 cmapsSize = 0;
+	u32 offset = getU32(finf, 0x18);
+	bool valid = true;
+	while (offset && valid) {
+		u8 blockHeader[0x14];
+		if (fseek(file, offset - 8, SEEK_SET) != 0 || fread(blockHeader, 1, sizeof(blockHeader), file) != sizeof(blockHeader)) break;
+		u32 blockSize = getU32(blockHeader, 0x04);
+		if (blockSize < sizeof(blockHeader)) break;
+		cmaps = (u8 *) realloc(cmaps, cmapsSize + blockSize);
+		u8 *block = cmaps + cmapsSize;
+		memcpy(block, blockHeader, sizeof(blockHeader));
+		valid = fread(block + sizeof(blockHeader), 1, blockSize - sizeof(blockHeader), file) == blockSize - sizeof(blockHeader);
+		// the block has to hold all the entries it claims to
+		u32 codepointCount = getU16(block, 0x0A) >= getU16(block, 0x08) ? getU16(block, 0x0A) - getU16(block, 0x08) + 1 : 0;
+		u32 type = getU32(block, 0x0C);
+		if (valid && type == 0) valid = blockSize >= 0x16;
+		else if (valid && type == 1) valid = blockSize >= 0x14 + codepointCount * 2;
+		else if (valid && type == 2) valid = blockSize >= 0x16 && blockSize >= 0x16 + getU16(block, 0x14) * 4u;
+		cmapsSize += blockSize;
+		offset = getU32(blockHeader, 0x10);
+	}
+	if (!valid) {
+		free(cmaps);
+		free(widthData);
+		fclose(file);
+		return font;
+	}
+	font.widthData = widthData;
+	font.charMap = buildCharMap([&](auto map) {
+		for (u8 *cmap = cmaps; cmap < cmaps + cmapsSize; cmap += getU32(cmap, 0x04)) {
+			mapBlock(cmap, [&](char16_t codepoint, u16 tileNum) {
+				if (tileNum < validTiles) map(codepoint, tileNum);
+			});
 		}
-		nextCMAP = getU32(cmap, 0x10);
+	});
+	free(cmaps);
+	font.replace = false;
+	font.replace = getTileNum(font, REPLACEMENT_CHAR) != NO_TILE;
+
+	NitroFontStream *stream = (NitroFontStream *) malloc(sizeof(NitroFontStream));
+	stream->file = file;
+	stream->tileDataOffset = getU32(finf, 0x10) - 8 + 0x10;
+	stream->tileCount = tileCount;
+	stream->pages = (u8 *) malloc(GLYPH_CACHE_PAGES * GLYPH_PAGE_TILES * font.tileSize);
+	stream->useCount = 0;
+	for (u8 i = 0; i < GLYPH_CACHE_PAGES; i++) {
+		stream->pageNums[i] = NO_TILE;
+		stream->lastUsed[i] = 0;
 	}
-	font.replace = font.charMap[REPLACEMENT_CHAR] != NO_TILE;
+	font.stream = stream;
 
 	return font;
 }
 
+void fontFree(NitroFont font) {
+	free(font.charMap);
+	if (font.stream) {
+		fclose(font.stream->file);
+		free(font.stream->pages);
+		free(font.stream);
+		free((u8 *) font.widthData);
+	}
+}
+
+const u8 *fontGetGlyph(NitroFont font, char16_t codepoint, const u8 **widths) {
+	if (!font.charMap || !font.widthData || font.encoding != 1 || font.bitdepth != 2) return NULL;
+
+	u16 tileNum = getTileNum(font, codepoint);
+	if (tileNum == NO_TILE) return NULL;
+
+	*widths = font.widthData + tileNum * 3;
+	return getTile(font, tileNum);
+}
+
 u8 fontGetCodePointWidth(NitroFont font, char16_t codepoint) {
 	if (!font.charMap || !font.widthData || font.encoding != 1) return 0;
 
-	u16 tileNum = font.charMap[codepoint];
-	if (tileNum == NO_TILE) tileNum = font.charMap[REPLACEMENT_CHAR];
+	u16 tileNum = getTileNum(font, codepoint);
 	if (tileNum == NO_TILE) return 0;
 
-	u8 *widths = font.widthData + tileNum * 3;
+	const u8 *widths = font.widthData + tileNum * 3;
 	return widths[2];
 }
 
 // this assumes character is in the buffer's bounds
 void fontPrintCodePoint(NitroFont font, const u16 *palette, char16_t codepoint, u16 *buffer, u32 bufferWidth, u32 x, u32 y) {
-	if (!font.tileData || !font.widthData || !font.charMap || font.encoding != 1 || font.bitdepth != 2) return;
+	if ((!font.tileData && !font.stream) || !font.widthData || !font.charMap || font.encoding != 1 || font.bitdepth != 2) return;
 
-	u16 tileNum = font.charMap[codepoint];
-	if (tileNum == NO_TILE) tileNum = font.charMap[REPLACEMENT_CHAR];
+	u16 tileNum = getTileNum(font, codepoint);
 	if (tileNum == NO_TILE) return;
 
-	u8 *tile = font.tileData + tileNum * font.tileSize;
-	u8 *widths = font.widthData + tileNum * 3;
+	const u8 *tile = getTile(font, tileNum);
+	if (!tile) return;
+	const u8 *widths = font.widthData + tileNum * 3;
 
 	buffer += x + y * bufferWidth;
 	for (u8 ty = 0; ty < font.tileHeight; ty++, buffer += bufferWidth) {
@@ -107,7 +281,7 @@ void fontPrintCodePoint(NitroFont font, const u16 *palette, char16_t codepoint,
 
 // this assumes string is in the buffer's bounds.
 void fontPrintUnicode(NitroFont font, const u16 *palette, const char16_t *codepoints, u16 *buffer, u32 bufferWidth, u32 x, u32 y, u32 maxWidth, bool scroll) {
-	if (!codepoints[0] || !font.tileData || !font.widthData || !font.charMap || font.encoding != 1 || font.bitdepth != 2) return;
+	if (!codepoints[0] || (!font.tileData && !font.stream) || !font.widthData || !font.charMap || font.encoding != 1 || font.bitdepth != 2) return;
 	
 	buffer += x + y * bufferWidth;
 	u32 totalX = 0;
@@ -117,8 +291,7 @@ void fontPrintUnicode(NitroFont font, const u16 *palette, const char16_t *codepo
 	if (scroll) {
 		u32 totalWidth = 0;
 		while (*ptr) {
-			u16 tileNum = font.charMap[*(ptr++)];
-			if (tileNum == NO_TILE) tileNum = font.charMap[REPLACEMENT_CHAR];
+			u16 tileNum = getTileNum(font, *(ptr++));
 			if (tileNum == NO_TILE) continue;
 			totalWidth += font.widthData[tileNum * 3 + 2];
 		}
@@ -131,12 +304,12 @@ void fontPrintUnicode(NitroFont font, const u16 *palette, const char16_t *codepo
 	}
 
 	while (true) {
-		u16 tileNum = font.charMap[*ptr];
-		if (tileNum == NO_TILE) tileNum = font.charMap[REPLACEMENT_CHAR];
+		u16 tileNum = getTileNum(font, *ptr);
 		if (tileNum == NO_TILE) continue;
 
-		u8 *tile = font.tileData + tileNum * font.tileSize;
-		u8 *widths = font.widthData + tileNum * 3;
+		const u8 *tile = getTile(font, tileNum);
+		if (!tile) return;
+		const u8 *widths = font.widthData + tileNum * 3;
 
 		u16 *buff = buffer + (ltr ? totalX : maxWidth - totalX - widths[2]);
 		u32 remainingSpace = maxWidth - totalX;
@@ -182,7 +355,7 @@ void fontPrintUnicode(NitroFont font, const u16 *palette, const char16_t *codepo
 
 // this assumes string is in the buffer's bounds.
 void fontPrintString(NitroFont font, const u16 *palette, const char *str, u16 *buffer, u32 bufferWidth, u32 x, u32 y, u32 maxWidth, bool scroll) {
-	if (!font.tileData || !font.widthData || !font.charMap || font.encoding != 1 || font.bitdepth != 2) return;
+	if ((!font.tileData && !font.stream) || !font.widthData || !font.charMap || font.encoding != 1 || font.bitdepth != 2) return;
 
 	const char *end = str;
 	while(*(end++));
@@ -1,5 +1,6 @@
 #include "util/helpers.hpp"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include "util/unicode.hpp"
 
@@ -15,6 +16,13 @@ jerry_value_t requireArgError(u32 expected, u32 received) {
 	return TypeError(msg);
 }
 
+jerry_value_t boundArgError(BoundArgError error) {
+	if (error.removed) return TypeError(WAS_REMOVED);
+	char msg[64];
+	snprintf(msg, sizeof(msg), "Expected type '%s'.", error.expected);
+	return TypeError(msg);
+}
+
 jerry_value_t StringUTF16(const char16_t* codepoints, jerry_size_t length) {
 	jerry_size_t convertedLength;
 	char *converted = UTF16toUTF8(codepoints, length, &convertedLength);
@@ -43,14 +51,15 @@ char *toRawString(const jerry_value_t value, jerry_size_t *stringSize) {
 }
 
 void printString(jerry_value_t stringValue) {
-	char *string = rawString(stringValue);
-	printf(string);
-	free(string);
+	forEachStringChunk(stringValue, [](const char *chunk, jerry_size_t size) {
+		fwrite(chunk, 1, size, stdout);
+	});
 }
 void printValue(const jerry_value_t value) {
-	char *string = toRawString(value);
-	printf(string);
-	free(string);
+	if (jerry_value_is_string(value)) return printString(value);
+	jerry_value_t stringVal = jerry_value_to_string(value);
+	printString(stringVal);
+	jerry_release_value(stringVal);
 }
 
 jerry_value_t getProperty(jerry_value_t object, const char *property) {